@@ -0,0 +1,210 @@
+/*
+console NBP currency converter
+
+MIT License
+
+Copyright (c) 2021 Kajetan Welc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+Best conversion routes between the currencies at the bid and ask rates.
+
+Every quote is an edge weighted with -log of the amount one unit of its source
+currency buys, so the cheapest path is the one that ends with the most money.
+All pairs are solved at once with Floyd-Warshall when a snapshot is applied,
+which leaves a conversion with two index lookups and one multiplication.
+*/
+
+#ifndef BID_ASK_ROUTES_H
+#define BID_ASK_ROUTES_H
+
+#include <currency_rate.h>
+
+#include <cmath>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+// one unit of from buys amount units of to
+struct bid_ask_quote {
+    std::string from;
+    std::string to;
+    double amount = 0;
+};
+
+
+struct bid_ask_routes {
+  private:
+    std::vector<std::string> codes;
+    std::unordered_map<std::string, int> indices;
+
+    // costs[from * size + to], infinite where no route exists
+    std::vector<double> costs;
+
+    // next[from * size + to] is the currency after from on the route
+    std::vector<int> next;
+
+    auto size() const -> int
+    {
+        return (int)codes.size();
+    }
+
+    auto index_of(std::string const& code) -> int
+    {
+        auto const it = indices.find(code);
+        if (it != indices.end()) {
+            return it->second;
+        }
+
+        codes.push_back(code);
+        return indices[code] = size() - 1;
+    }
+
+  public:
+    // Table C quotes every currency against PLN: one PLN buys 1 / ask units
+    // and one unit sells for bid PLN. A quote with bid above ask would be a
+    // free money cycle and is skipped.
+    static auto from_bid_ask_rates(
+        std::vector<currency_bid_ask> const& rates) -> bid_ask_routes
+    {
+        std::vector<bid_ask_quote> quotes;
+        for (auto const& rate : rates) {
+            if (rate.bid <= 0 || rate.ask <= 0 || rate.bid > rate.ask) {
+                continue;
+            }
+
+            quotes.push_back({"PLN", rate.code, 1 / (double)rate.ask});
+            quotes.push_back({rate.code, "PLN", (double)rate.bid});
+        }
+
+        return bid_ask_routes{quotes};
+    }
+
+    bid_ask_routes() = default;
+
+    // Quotes with no positive amount are skipped. The quotes must hold no
+    // cycle that ends with more money than it started with.
+    explicit bid_ask_routes(std::vector<bid_ask_quote> const& quotes)
+    {
+        for (auto const& quote : quotes) {
+            index_of(quote.from);
+            index_of(quote.to);
+        }
+
+        auto const n = size();
+        costs.assign(n * n, std::numeric_limits<double>::infinity());
+        next.assign(n * n, -1);
+
+        for (auto i = 0; i < n; i++) {
+            costs[i * n + i] = 0;
+            next[i * n + i]  = i;
+        }
+
+        for (auto const& quote : quotes) {
+            if (quote.amount <= 0) {
+                continue;
+            }
+
+            auto const from = indices[quote.from];
+            auto const to   = indices[quote.to];
+            auto const cost = -std::log(quote.amount);
+
+            if (from != to && cost < costs[from * n + to]) {
+                costs[from * n + to] = cost;
+                next[from * n + to]  = to;
+            }
+        }
+
+        for (auto k = 0; k < n; k++) {
+            for (auto i = 0; i < n; i++) {
+                auto const to_k = costs[i * n + k];
+                if (to_k == std::numeric_limits<double>::infinity()) {
+                    continue;
+                }
+
+                for (auto j = 0; j < n; j++) {
+                    auto const through_k = to_k + costs[k * n + j];
+                    if (through_k < costs[i * n + j]) {
+                        costs[i * n + j] = through_k;
+                        next[i * n + j]  = next[i * n + k];
+                    }
+                }
+            }
+        }
+    }
+
+    auto has_currency(std::string const& code) const -> bool
+    {
+        return indices.count(code) > 0;
+    }
+
+    // Returns false if either currency has no quotes or no route joins them.
+    auto convert(double const value,
+                 std::string const& from,
+                 std::string const& to,
+                 double& result) const -> bool
+    {
+        auto const from_it = indices.find(from);
+        auto const to_it   = indices.find(to);
+        if (from_it == indices.end() || to_it == indices.end()) {
+            return false;
+        }
+
+        auto const cost = costs[from_it->second * size() + to_it->second];
+        if (cost == std::numeric_limits<double>::infinity()) {
+            return false;
+        }
+
+        result = value * std::exp(-cost);
+        return true;
+    }
+
+    // the currencies of the best route from the first to the last one, empty
+    // if there is none
+    auto route(std::string const& from, std::string const& to) const
+        -> std::vector<std::string>
+    {
+        std::vector<std::string> result;
+
+        auto const from_it = indices.find(from);
+        auto const to_it   = indices.find(to);
+        if (from_it == indices.end() || to_it == indices.end()) {
+            return result;
+        }
+
+        auto index   = from_it->second;
+        auto const n = size();
+        if (next[index * n + to_it->second] == -1) {
+            return result;
+        }
+
+        result.push_back(codes[index]);
+        while (index != to_it->second) {
+            index = next[index * n + to_it->second];
+            result.push_back(codes[index]);
+        }
+
+        return result;
+    }
+};
+
+#endif
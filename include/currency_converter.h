@@ -27,16 +27,46 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define CURRENCY_CONVERTER_H
 
 #include <cpr/cpr.h>  // https://github.com/whoshuu/cpr
-#include <fort.hpp>   // https://github.com/seleznevae/libfort
+#include <bid_ask_routes.h>
+#include <currency_converter_core.h>
+#include <currency_names.h>
+#include <currency_table_renderer.h>
+#include <fetch_stats.h>
+#include <fort.hpp>  // https://github.com/seleznevae/libfort
+#include <gzip_file.h>
+#include <http_client.h>
+#include <iso4217.h>
 #include <math.h>
 #include <nlohmann/json.hpp>        // https://github.com/nlohmann/json
+#include <range_stats.h>
+#include <rate_backfill.h>
+#include <rate_history.h>
+#include <rate_matrix.h>
+#include <rolling_stats.h>
+#include <rate_providers.h>
+#include <rendered_table_cache.h>
+#include <shared_rates.h>
+#include <task_result.h>
 #include <termcolor/termcolor.hpp>  // https://github.com/ikalnytskyi/termcolor
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <future>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <sstream>
 #include <string>
 #include <thread>
+#include <utility>
 #include <vector>
 
 using json = nlohmann::json;
@@ -44,38 +74,127 @@ using json = nlohmann::json;
 
 struct currency_converter {
   private:
-    cpr::Url const NBP_URL =
-        "api.nbp.pl/api/exchangerates/tables/a?format=json";
-    std::map<std::string, cpr::Url> const CURRENCY_NAMES_URLS{
-        {"EN",
-         "openexchangerates.org/api/currencies.json"} /*,
-    {"EN",
-    "brofrain.github.io/nbp_currency_converter_api/currency_names/currency_names_en.json"},
-    {"DE",
-    "brofrain.github.io/nbp_currency_converter_api/currency_names/currency_names_de.json"},
-    {"RU",
-    "brofrain.github.io/nbp_currency_converter_api/currency_names/currency_names_ru.json"},
-    {"JA",
-    "brofrain.github.io/nbp_currency_converter_api/currency_names/currency_names_ja.json"}*/
-    };
+    // src/bench.cpp measures the private hot paths
+    friend struct currency_converter_bench;
 
     std::map<std::string, json> const HELP_OBJECTS{
         {"AUTHOR",
          {{"template", "author"},
           {"description", "print the author of the program"}}},
+        {"BACKFILL",
+         {{"template", "backfill FROM_DATE TO_DATE [OPTIONS...]"},
+          {"description",
+           "download the NBP tables A published between the dates "
+           "(YYYY-MM-DD) into the rates history, in ranges of at most 93 "
+           "days at the same time. The days the history already holds are "
+           "skipped, so a failed backfill resumes where it stopped"},
+          {"options",
+           json::array(
+               {json::object({{"template", "-j, --jobs NUMBER"},
+                              {"description",
+                               "download at most NUMBER ranges at a time "
+                               "(default 4)"}}),
+                json::object({{"template", "-r, --rate NUMBER"},
+                              {"description",
+                               "start at most NUMBER requests per second, 0 "
+                               "for no limit (default 5)"}}),
+                json::object({{"template", "-s, --silent-mode"},
+                              {"description", "print nothing"}})})}}},
+        {"DAEMON",
+         {{"template", "daemon [OPTIONS...]"},
+          {"description",
+           "keep running and update the exchange rates periodically, with "
+           "the rates history and the rolling statistics kept up to date "
+           "and published into the shared memory segment. SIGUSR1 prints "
+           "the fetch stage timings and the rolling statistics, SIGINT and "
+           "SIGTERM stop it"},
+          {"options",
+           json::array(
+               {json::object({{"template", "-i, --interval SECONDS"},
+                              {"description",
+                               "update every SECONDS seconds (default "
+                               "3600)"}}),
+                json::object({{"template", "-s, --silent-mode"},
+                              {"description",
+                               "print nothing but what SIGUSR1 asks "
+                               "for"}})})}}},
         {"DATE",
-         {{"template", "date"},
-          {"description", "print publication date of the exchange rates"}}},
+         {{"template", "date [OPTIONS...]"},
+          {"description", "print publication date of the exchange rates"},
+          {"options",
+           json::array({json::object(
+               {{"template", "-t, --tables"},
+                {"description",
+                 "also print the effective date and the number of rates of "
+                 "every NBP table the rates come from"}})})}}},
         {"EXIT", {{"template", "exit"}, {"description", "exit the program"}}},
         {"FETCHLANG",
-         {{"template", "fetchlang LANGUAGE_CODE API_URL [OPTIONS...]"},
+         {{"template",
+           "fetchlang [LANGUAGE_CODE API_URL...] [OPTIONS...]"},
           {"description",
-           "fetch additional currency names language from the url"},
+           "fetch additional currency names languages from the urls at the "
+           "same time"},
           {"options",
-           json::array({json::object({{"template", "-s, --silent-mode"},
-                                      {"description", "print nothing"}})})}}},
+           json::array(
+               {json::object({{"template", "-f, --file MANIFEST_PATH"},
+                              {"description",
+                               "also fetch the languages listed in the file, "
+                               "one \"LANGUAGE_CODE API_URL\" pair per line"}}),
+                json::object({{"template", "-j, --jobs NUMBER"},
+                              {"description",
+                               "fetch at most NUMBER languages at a time "
+                               "(default 4)"}}),
+                json::object({{"template", "-s, --silent-mode"},
+                              {"description", "print nothing"}})})}}},
         {"LOGO",
          {{"template", "logo"}, {"description", "print the program logo"}}},
+        {"MATRIX",
+         {{"template", "matrix [CURRENCY_CODES...] [OPTIONS...]"},
+          {"description",
+           "print the value of one unit of every currency in every other "
+           "one, row by row as the rows are worked out. If no codes are "
+           "present, every currency is printed"},
+          {"options",
+           json::array(
+               {json::object({{"template", "-f, --format csv|jsonl|table"},
+                              {"description",
+                               "print comma separated values, one JSON "
+                               "object per row or a table (default). The "
+                               "csv and jsonl rates have 6 significant "
+                               "digits"}}),
+                json::object({{"template", "-t, --tables LETTERS"},
+                              {"description",
+                               "limit the currencies to those of the "
+                               "selected NBP tables, e.g. \"a\" or \"ab\", "
+                               "and PLN"}})})}}},
+        {"RANGE",
+         {{"template",
+           "range CURRENCY_CODES... FROM_DATE TO_DATE [OPTIONS...]"},
+          {"description",
+           "print the daily exchange rates of the currencies between the "
+           "dates (YYYY-MM-DD) from the rates history"},
+          {"options",
+           json::array(
+               {json::object({{"template", "-b, --base CURRENCY_CODE"},
+                              {"description",
+                               "express the rates in the selected currency "
+                               "instead of PLN"}}),
+                json::object({{"template", "--stats"},
+                              {"description",
+                               "print the first, last, lowest, highest and "
+                               "mean rate and the standard deviation "
+                               "instead"}})})}}},
+        {"ROLLING",
+         {{"template", "rolling [CURRENCY_CODES...]"},
+          {"description",
+           "print the 30 and 90 day moving averages of the rates in PLN and "
+           "their volatilities (standard deviations of the daily log "
+           "returns). If no codes are present, every currency is printed"}}},
+        {"STATS",
+         {{"template", "stats"},
+          {"description",
+           "print the latest timings and percentiles of the data fetch "
+           "stages"}}},
         {"TABLE",
          {{"template", "table BASE_CURRENCY_CODE [OPTIONS...]"},
           {"description",
@@ -86,6 +205,12 @@ struct currency_converter {
                               {"description",
                                "limit the table target currencies to the "
                                "selected ones"}}),
+                json::object({{"template", "@DATE"},
+                              {"description",
+                               "print the rates in force on the date "
+                               "(YYYY-MM-DD) from the rates history, those "
+                               "of the last earlier table on weekends and "
+                               "holidays"}}),
                 json::object(
                     {{"template", "-n, --name-currencies [LANGUAGE_CODE]"},
                      {"description",
@@ -108,7 +233,20 @@ struct currency_converter {
                 json::object({{"template", "-r, --result-only"},
                               {"description",
                                "print only the result value. Cannot be used "
-                               "with option -n, --name-currencies"}})})}}},
+                               "with option -n, --name-currencies"}}),
+                json::object(
+                    {{"template", "--bidask"},
+                     {"description",
+                      "sell the base currencies and buy the target one at "
+                      "the bid and ask rates of NBP table C, along the best "
+                      "route, which is printed as well. Cannot be used with "
+                      "@DATE"}}),
+                json::object(
+                    {{"template", "@DATE"},
+                     {"description",
+                      "convert at the rates in force on the date "
+                      "(YYYY-MM-DD) from the rates history, those of the "
+                      "last earlier table on weekends and holidays"}})})}}},
         {"UPDATE",
          {{"template", "update [OPTIONS...]"},
           {"description", "update the entire currency converter database"},
@@ -118,14 +256,30 @@ struct currency_converter {
 
     std::string const DEFAULT_LANGUAGE      = "EN";
     int const DEFAULT_DECIMAL_POINTS_NUMBER = 4;
+    int const FETCHLANG_DEFAULT_JOBS_COUNT  = 4;
+    int const BACKFILL_DEFAULT_JOBS_COUNT   = 4;
+    double const BACKFILL_DEFAULT_RATE      = 5;
+    int const DAEMON_DEFAULT_INTERVAL_S     = 3600;
+
+    // how often the daemon looks at the signals it got
+    std::chrono::milliseconds const DAEMON_POLL_INTERVAL{100};
+
+    // set by the signal handlers of the daemon
+    static inline volatile std::sig_atomic_t daemon_stop_requested   = 0;
+    static inline volatile std::sig_atomic_t daemon_report_requested = 0;
 
     bool awaits_commands = false;
-    std::map<std::string, float> exchange_rates{{"PLN", 1}};
-    std::map<std::string, std::map<std::string, std::string>> currency_names;
-    std::string rates_publication_date;
+
+    // fetches the rates and keeps the rates, the currency names, the rates
+    // history and the fetch timings; the commands read its newest snapshot
+    currency_converter_core core;
 
     std::vector<std::string> error_strings;
-    std::mutex error_strings_mtx;
+
+    // the errors of the sources when the loaded rates came from the cache,
+    // empty once fresh rates are fetched
+    bool rates_stale = false;
+    std::vector<std::string> stale_error_strings;
 
     enum class color { blue, cyan, green, light, red, yellow };
 
@@ -225,26 +379,6 @@ struct currency_converter {
         return str;
     }
 
-    auto string_capitalize_words(std::string str) -> std::string
-    {
-        auto capitalize_next_char = bool{true};
-
-        for (auto& character : str) {
-            if (capitalize_next_char) {
-                character = std::toupper(character);
-
-                capitalize_next_char = false;
-                continue;
-            }
-
-            if (character == ' ') {
-                capitalize_next_char = true;
-            }
-        }
-
-        return str;
-    }
-
     template<typename T>
     auto vector_index_of(std::vector<T> const& v, T const& element_to_find)
         -> int
@@ -260,47 +394,24 @@ struct currency_converter {
         return -1;
     }
 
-    auto float_to_fixed(float const& number, int const& decimal_points) -> float
-    {
-        auto const multiplier = (int)std::pow(10, decimal_points);
-
-        auto result_number = float{};
-
-        result_number = (int)(number * multiplier + .5);
-        result_number = result_number / multiplier;
-
-        return result_number;
-    }
-
     auto float_to_fixed_to_string(float const& number,
                                   int const& decimal_points = 2) -> std::string
     {
-        std::stringstream tmp_ss;
-        tmp_ss << std::fixed << std::setprecision(decimal_points)
-               << float_to_fixed(number, decimal_points);
-
-        return tmp_ss.str();
+        return float_to_fixed_string(number, decimal_points);
     }
 
-    auto parse_json(std::string const& str,
-                    std::string const parse_error_string = "JSON parse error")
-        -> json
+    static auto
+    parse_json(std::string const& str,
+               std::string const& parse_error_string = "JSON parse error")
+        -> task_result<json>
     {
-        auto parsed_data = json{};
-        {
-            std::unique_lock<std::mutex> lck{error_strings_mtx};
-
-            try {
-                parsed_data = json::parse(str);
-            } catch (nlohmann::detail::parse_error const&) {
-                error_strings.push_back(parse_error_string);
-            } catch (std::exception const& e) {
-                error_strings.push_back(e.what());
-            }
+        try {
+            return task_result<json>::success(json::parse(str));
+        } catch (nlohmann::detail::parse_error const&) {
+            return task_result<json>::failure(parse_error_string);
+        } catch (std::exception const& e) {
+            return task_result<json>::failure(e.what());
         }
-
-
-        return parsed_data;
     }
 
     auto print_error_strings() -> void
@@ -322,6 +433,38 @@ struct currency_converter {
         print("\n");
     }
 
+    auto print_stale_rates_warning() -> void
+    {
+        print("Fetching data has failed! Using the cached rates of "
+                  + core.snapshot()->publication_date() + "\n",
+              color::yellow);
+
+        auto text = std::string{"Problems occurred: "};
+        for (auto i = 0; i < (int)stale_error_strings.size(); i++) {
+            text += (i ? ", " : "") + stale_error_strings[i];
+        }
+        print(text + "\n", color::yellow);
+    }
+
+    // Prints the message and the comma separated list in red. Prints
+    // nothing and returns false if the list is empty.
+    auto print_list_error(std::string const& message,
+                          std::vector<std::string> const& list) -> bool
+    {
+        if (list.empty()) {
+            return false;
+        }
+
+        auto text = message;
+        for (auto i = 0; i < (int)list.size(); i++) {
+            text += (i ? ", " : "") + list[i];
+        }
+        print(text, color::red);
+        print("\n");
+
+        return true;
+    }
+
     auto print_incorrect_command_usage_string(std::string const& command)
         -> void
     {
@@ -330,168 +473,316 @@ struct currency_converter {
         print("\n");
     }
 
-    auto set_currency_names(std::string const& language_code,
-                            json const& names_obj) -> void
+    auto currency_names_snapshot() const
+        -> std::shared_ptr<currency_name_table const>
     {
-        for (auto const& [currency, name] : names_obj.items()) {
-            currency_names[language_code][currency] =
-                string_capitalize_words(name.get<std::string>());
-        }
+        return core.snapshot()->currency_names();
     }
 
-    auto set_exchange_rates(json const& nbp_json) -> void
+    // The currency names are not fetched here; each language is loaded by
+    // the core when a command asks for it.
+    auto fetch_data() -> void
     {
-        rates_publication_date = nbp_json[0]["effectiveDate"];
+        auto const fetched = core.refresh();
 
-        auto pl_currency_names = json{{"PLN", "Polski złoty"}};
+        if (!fetched.ok) {
+            error_strings.insert(error_strings.end(),
+                                 fetched.errors.begin(),
+                                 fetched.errors.end());
+            return;
+        }
 
-        for (auto const& rate : nbp_json[0]["rates"]) {
-            auto const code = rate["code"].get<std::string>();
+        rates_stale         = fetched.stale;
+        stale_error_strings = fetched.stale ? fetched.errors
+                                            : std::vector<std::string>{};
+    }
 
-            exchange_rates[code]    = rate["mid"].get<float>();
-            pl_currency_names[code] = rate["currency"];
+    // returns false after printing why the names could not be loaded
+    auto print_load_currency_names_error(std::string const& language_code)
+        -> bool
+    {
+        auto const loaded = core.load_currency_names(language_code);
+        if (loaded.ok()) {
+            return true;
         }
 
-        set_currency_names("PL", pl_currency_names);
+        print("Fetching " + language_code + " currency names has failed!\n",
+              color::red);
+        print("Problems occurred: " + loaded.error + "\n", color::red);
+
+        return false;
     }
 
-    auto fetch_data() -> void
+    // "LANGUAGE_CODE API_URL" lines; empty lines and lines starting with '#'
+    // are skipped
+    auto read_currency_names_manifest(
+        std::string const& file_path,
+        std::vector<std::pair<std::string, std::string>>& languages) -> bool
     {
-        cpr::Response nbp_response;
+        std::ifstream file{file_path};
+        if (!file) {
+            return false;
+        }
 
-        auto nbp_json = json::array();
-        std::map<std::string, json> currency_names_jsons;
+        auto line = std::string{};
+        while (std::getline(file, line)) {
+            auto line_ss = std::istringstream{line};
 
-        auto nbp_thread =
-            std::thread{[&] { nbp_response = cpr::Get(NBP_URL); }};
-        std::vector<std::thread> currency_names_threads;
-        for (auto const& [lang, url] : CURRENCY_NAMES_URLS) {
-            auto const& l = lang;
-            auto const& u = url;
+            auto language_code = std::string{};
+            auto url           = std::string{};
+            if (!(line_ss >> language_code) || language_code[0] == '#') {
+                continue;
+            }
+            if (!(line_ss >> url)) {
+                return false;
+            }
 
-            currency_names_threads.push_back(std::thread{[&] {
-                currency_names_jsons[l] = fetch_currency_names_json(l, u);
-            }});
+            languages.emplace_back(string_to_uppercase(language_code), url);
         }
 
-        nbp_thread.join();
-        for (auto& each : currency_names_threads) {
-            each.join();
-        }
+        return true;
+    }
+
+    // raw_args are the args as typed, for the manifest path and the urls
+    auto fetch_additional_currency_names_language(
+        std::vector<std::string> const& args,
+        std::vector<std::string> const& raw_args) -> void
+    {
+        auto const args_size = (int)args.size();
 
-        if (nbp_response.status_code >= 400) {
-            error_strings.push_back("NBP HTTP request error");
+        auto silent_mode   = bool{false};
+        auto jobs_count    = FETCHLANG_DEFAULT_JOBS_COUNT;
+        auto manifest_path = std::string{};
+
+        // indices into args
+        std::vector<int> positional_args;
+        for (auto i = 1; i < args_size; i++) {
+            if (args[i] == "-S" || args[i] == "--SILENT-MODE") {
+                silent_mode = true;
+            } else if ((args[i] == "-J" || args[i] == "--JOBS")
+                       && i + 1 < args_size) {
+                try {
+                    jobs_count = std::stoi(args[++i]);
+                } catch (...) {
+                    jobs_count = 0;
+                }
+            } else if ((args[i] == "-F" || args[i] == "--FILE")
+                       && i + 1 < args_size && manifest_path.empty()) {
+                manifest_path = raw_args[++i];
+            } else {
+                positional_args.push_back(i);
+            }
         }
 
-        if (!error_strings.empty()) {
+        if (jobs_count < 1 || positional_args.size() % 2
+            || (positional_args.empty() && manifest_path.empty())) {
+            print_incorrect_command_usage_string("fetchlang");
             return;
         }
 
-        nbp_json = parse_json(nbp_response.text, "NBP API parse error");
+        std::vector<std::pair<std::string, std::string>> languages;
+        for (auto i = std::size_t{0}; i < positional_args.size(); i += 2) {
+            languages.emplace_back(args[positional_args[i]],
+                                   raw_args[positional_args[i + 1]]);
+        }
 
-        if (!error_strings.empty()) {
+        if (!manifest_path.empty()
+            && !read_currency_names_manifest(manifest_path, languages)) {
+            if (!silent_mode) {
+                print("Cannot read the manifest file: " + manifest_path + "\n",
+                      color::red);
+            }
             return;
         }
 
-        set_exchange_rates(nbp_json);
+        auto const results = core.fetch_currency_names(languages, jobs_count);
 
-        for (auto const& [lang, obj] : currency_names_jsons) {
-            set_currency_names(lang, obj);
+        if (silent_mode) {
+            return;
         }
-    }
 
-    auto fetch_currency_names_json(std::string const& language_code,
-                                   cpr::Url const& url) -> json
-    {
-        auto names_obj = json::object();
-
-        cpr::Response response = cpr::Get(url);
+        auto added_count = int{0};
+        for (auto i = std::size_t{0}; i < languages.size(); i++) {
+            auto const& language_code = languages[i].first;
 
-        if (response.status_code >= 400) {
-            {
-                std::unique_lock<std::mutex> lck{error_strings_mtx};
-                error_strings.push_back(language_code
-                                        + " currency names HTTP request error");
+            if (results[i].ok()) {
+                print(language_code
+                          + " currency names have been added successfully!\n",
+                      color::green);
+                added_count++;
+                continue;
             }
 
-            return json::object();
+            print("Fetching " + language_code + " currency names has failed!\n",
+                  color::red);
+            print("Problems occurred: " + results[i].error + "\n", color::red);
         }
 
-        names_obj = parse_json(
-            response.text, language_code + " currency names API parse error");
-
-        {
-            std::unique_lock<std::mutex> lck{error_strings_mtx};
-            if (!error_strings.empty()) {
-                return json::object();
-            }
+        if (languages.size() > 1) {
+            print(std::to_string(added_count) + " of "
+                      + std::to_string(languages.size())
+                      + " languages have been added\n",
+                  added_count == (int)languages.size() ? color::green
+                                                       : color::yellow);
         }
 
-        return names_obj;
+        if (added_count < (int)languages.size()) {
+            print("Please check your input data...\n", color::red);
+        }
     }
 
-    auto fetch_additional_currency_names_language(
-        std::vector<std::string> const& args) -> void
+    auto backfill_history(std::vector<std::string> const& args) -> void
     {
         auto const args_size = (int)args.size();
 
-        auto silent_mode_index = vector_index_of(args, std::string{"-S"});
-        if (silent_mode_index == -1) {
-            silent_mode_index =
-                vector_index_of(args, std::string{"--SILENT-MODE"});
+        auto silent_mode = bool{false};
+        auto jobs_count  = BACKFILL_DEFAULT_JOBS_COUNT;
+        auto rate        = BACKFILL_DEFAULT_RATE;
+
+        std::vector<std::string> positional_args;
+        for (auto i = 1; i < args_size; i++) {
+            if (args[i] == "-S" || args[i] == "--SILENT-MODE") {
+                silent_mode = true;
+            } else if ((args[i] == "-J" || args[i] == "--JOBS")
+                       && i + 1 < args_size) {
+                try {
+                    jobs_count = std::stoi(args[++i]);
+                } catch (...) {
+                    jobs_count = 0;
+                }
+            } else if ((args[i] == "-R" || args[i] == "--RATE")
+                       && i + 1 < args_size) {
+                try {
+                    rate = std::stod(args[++i]);
+                } catch (...) {
+                    rate = -1;
+                }
+            } else {
+                positional_args.push_back(args[i]);
+            }
         }
 
-        auto const silent_mode = bool{silent_mode_index != -1};
-
-        if ((!silent_mode && args_size != 3) || (silent_mode && args_size != 4)
-            || (silent_mode && silent_mode_index != args_size - 1)) {
-            print_incorrect_command_usage_string("fetchlang");
+        if (jobs_count < 1 || rate < 0 || positional_args.size() != 2) {
+            print_incorrect_command_usage_string("backfill");
             return;
         }
 
-        auto const& language_code = args[1];
-        auto const url            = cpr::Url{string_to_lowercase(args[2])};
-
-        auto const currency_names_json =
-            fetch_currency_names_json(language_code, url);
+        auto const from_day = date_to_days(positional_args[0]);
+        auto const to_day   = date_to_days(positional_args[1]);
+        for (auto const& date : positional_args) {
+            if (date_to_days(date) == -1) {
+                if (!silent_mode) {
+                    print("Incorrect date: " + date + "\n", color::red);
+                }
+                return;
+            }
+        }
+        if (from_day > to_day) {
+            print_incorrect_command_usage_string("backfill");
+            return;
+        }
 
-        if (error_strings.empty()) {
-            set_currency_names(language_code, currency_names_json);
+        auto const result = core.backfill(from_day, to_day, jobs_count, rate);
 
-            if (!silent_mode) {
-                print(language_code
-                          + " currency names have been added successfully!\n",
-                      color::green);
-            }
+        if (silent_mode) {
+            return;
+        }
 
+        if (!result.requests_count) {
+            print("The rates history already holds the tables of these "
+                  "dates\n",
+                  color::green);
             return;
         }
 
-        if (!silent_mode) {
-            print("Fetching " + language_code + " currency names has failed!\n",
-                  color::red);
-            print_error_strings();
-            print("Please check your input data...\n", color::red);
+        print(std::to_string(result.added_count)
+                  + " tables have been added to the rates history in "
+                  + std::to_string(result.requests_count) + " requests\n",
+              result.errors.empty() ? color::green : color::yellow);
+
+        for (auto const& error : result.errors) {
+            print("Downloading the tables of " + error + "\n", color::red);
+        }
+        if (!result.errors.empty()) {
+            print("Run the command again to resume\n", color::red);
         }
-        error_strings.clear();
     }
 
     auto is_correct_currency_code(std::string const& str) -> bool
     {
-        return exchange_rates.count(str);
+        return core.snapshot()->find(str) != nullptr;
+    }
+
+    // ISO 4217 minor units of the currency, the rate precision where there
+    // are none
+    auto amount_decimal_points(std::string const& currency) const -> int
+    {
+        auto const id = iso4217_id(currency);
+        if (id == -1 || iso4217_minor_units(id) == -1) {
+            return DEFAULT_DECIMAL_POINTS_NUMBER;
+        }
+
+        return iso4217_minor_units(id);
     }
 
     auto is_correct_language(std::string const& str) -> bool
     {
-        return currency_names.count(str);
+        return core.is_known_language(str);
     }
 
-    auto convert_currency(float const& input_value,
-                          std::string const& input_currency,
-                          std::string const& target_currency) -> float
+    // Takes the "@DATE" argument out of args and takes the rates in force on
+    // that day from the history, or the newest rates if there is no such
+    // argument. table_date is left empty then. Prints why and returns false
+    // if no table was in force.
+    auto take_dated_rates(std::vector<std::string>& args,
+                          std::shared_ptr<rates_snapshot const>& rates,
+                          std::string& table_date) -> bool
     {
-        auto const value_in_PLN = input_value * exchange_rates[input_currency];
-        return value_in_PLN / exchange_rates[target_currency];
+        rates = core.snapshot();
+
+        auto const it =
+            std::find_if(args.begin(), args.end(), [](auto const& each) {
+                return !each.empty() && each[0] == '@';
+            });
+        if (it == args.end()) {
+            return true;
+        }
+
+        auto const date = it->substr(1);
+        args.erase(it);
+
+        auto const day = date_to_days(date);
+        if (day == -1) {
+            print("Incorrect date: " + date + "\n", color::red);
+            return false;
+        }
+
+        rates = rates->on_day(day);
+        if (!rates) {
+            print("No exchange rates on or before " + date + "\n",
+                  color::red);
+            return false;
+        }
+
+        table_date = rates->publication_date();
+
+        return true;
+    }
+
+    // the codes that have no rate in rates, printed if there are any
+    auto print_missing_dated_rates(std::vector<std::string> const& codes,
+                                   rates_snapshot const& rates,
+                                   std::string const& table_date) -> bool
+    {
+        std::vector<std::string> missing_currency_codes;
+        for (auto const& code : codes) {
+            if (!rates.find(code)) {
+                missing_currency_codes.push_back(code);
+            }
+        }
+
+        return print_list_error("No exchange rates on " + table_date + " of: ",
+                                missing_currency_codes);
     }
 
     auto print_logo() -> void
@@ -575,27 +866,496 @@ struct currency_converter {
             print("\n");
         }
 
-        if (!unknown_commands.empty()) {
-            print("No help entries for: ", color::red);
+        print_list_error("No help entries for: ", unknown_commands);
+    }
 
-            auto const unknown_commands_size = (int)unknown_commands.size();
-            auto unknown_command_index       = int{0};
-            for (auto const& each : unknown_commands) {
-                print(each, color::red);
+    auto print_fetch_stats() -> void
+    {
+        auto const& fetch_timings = core.fetch_timings();
+        auto const sources        = fetch_timings.sources();
+        if (sources.empty()) {
+            print("No fetches recorded yet\n", color::red);
+            return;
+        }
 
-                if (unknown_command_index < unknown_commands_size - 1) {
-                    print(", ", color::red);
+        auto const stages =
+            std::vector<std::pair<std::string,
+                                  std::function<double(fetch_record const&)>>>{
+                {"DNS", [](auto const& r) { return r.http.dns_ms; }},
+                {"Connect", [](auto const& r) { return r.http.connect_ms; }},
+                {"TLS", [](auto const& r) { return r.http.tls_ms; }},
+                {"Wait", [](auto const& r) { return r.http.wait_ms; }},
+                {"Transfer", [](auto const& r) { return r.http.transfer_ms; }},
+                {"Parse", [](auto const& r) { return r.parse_ms; }},
+                {"Apply", [](auto const& r) { return r.apply_ms; }},
+                {"Total", [](auto const& r) { return r.total_ms(); }}};
+
+        for (auto const& source : sources) {
+            auto const records = fetch_timings.of_source(source);
+
+            print(source, color::yellow);
+            print(" (" + std::to_string(records.size()) + " fetches, ms)\n");
+
+            fort::utf8_table table;
+            table << fort::header << "Stage"
+                  << "Latest"
+                  << "p50"
+                  << "p90"
+                  << "p99" << fort::endr;
+
+            for (auto const& [stage_name, stage] : stages) {
+                table << stage_name
+                      << float_to_fixed_to_string(stage(records.back()), 2);
+                for (auto const p : {50.0, 90.0, 99.0}) {
+                    table << float_to_fixed_to_string(
+                        fetch_stats::percentile(records, stage, p), 2);
                 }
+                table << fort::endr;
+            }
 
-                unknown_command_index++;
+#if defined(__APPLE__) || defined(__unix__) || defined(__unix)
+            table.set_border_style(FT_BOLD2_STYLE);
+#elif defined(_WIN32) || defined(_WIN64)
+            table.set_border_style(FT_BASIC2_STYLE);
+#endif
+            table.row(0).set_cell_content_fg_color(fort::color::light_yellow);
+            for (auto column = 1; column < 5; column++) {
+                table.column(column).set_cell_text_align(
+                    fort::text_align::right);
             }
-            print("\n");
+
+            print(table.to_string() + "\n");
         }
     }
 
-    auto print_publication_date() -> void
+    auto is_history_currency_code(std::string const& str) -> bool
+    {
+        return str == "PLN" || core.snapshot()->history().has_currency(str);
+    }
+
+    auto set_table_style(fort::utf8_table& table) -> void
     {
-        print(rates_publication_date + "\n");
+#if defined(__APPLE__) || defined(__unix__) || defined(__unix)
+        table.set_border_style(FT_BOLD2_STYLE);
+#elif defined(_WIN32) || defined(_WIN64)
+        table.set_border_style(FT_BASIC2_STYLE);
+#endif
+        table.row(0).set_cell_content_fg_color(fort::color::light_yellow);
+    }
+
+    auto print_range_rates(std::vector<std::string> const& args) -> void
+    {
+        auto const args_size = (int)args.size();
+
+        auto print_stats = bool{false};
+        auto base        = std::string{"PLN"};
+        std::vector<std::string> positional_args;
+        for (auto i = 1; i < args_size; i++) {
+            if (args[i] == "--STATS") {
+                print_stats = true;
+            } else if ((args[i] == "-B" || args[i] == "--BASE")
+                       && i + 1 < args_size) {
+                base = args[++i];
+            } else {
+                positional_args.push_back(args[i]);
+            }
+        }
+
+        auto const positional_args_size = (int)positional_args.size();
+        if (positional_args_size < 3) {
+            print_incorrect_command_usage_string("range");
+            return;
+        }
+
+        auto const& from_date = positional_args[positional_args_size - 2];
+        auto const& to_date   = positional_args[positional_args_size - 1];
+        auto const from_day   = date_to_days(from_date);
+        auto const to_day     = date_to_days(to_date);
+        if (from_day == -1 || to_day == -1 || from_day > to_day) {
+            print_incorrect_command_usage_string("range");
+            return;
+        }
+
+        auto const codes =
+            std::vector<std::string>(positional_args.begin(),
+                                     positional_args.end() - 2);
+
+        std::vector<std::string> unknown_currency_codes;
+        for (auto const& code : codes) {
+            if (!is_history_currency_code(code)) {
+                unknown_currency_codes.push_back(code);
+            }
+        }
+        if (!is_history_currency_code(base)) {
+            unknown_currency_codes.push_back(base);
+        }
+        if (print_list_error("Unknown currency codes: ",
+                             unknown_currency_codes)) {
+            return;
+        }
+
+        auto const rates    = core.snapshot();
+        auto const& history = rates->history();
+
+        auto const from_index =
+            history.day_index_at_or_before(from_day - 1) + 1;
+        auto const to_index = history.day_index_at_or_before(to_day) + 1;
+        if (from_index >= to_index) {
+            print("No exchange rates between " + from_date + " and " + to_date
+                      + "\n",
+                  color::red);
+            return;
+        }
+
+        print("Rates in ");
+        print(base, color::yellow);
+        print(" between " + from_date + " and " + to_date + "\n");
+
+        fort::utf8_table table;
+
+        if (print_stats) {
+            table << fort::header << "Currency"
+                  << "Days"
+                  << "First"
+                  << "Last"
+                  << "Min"
+                  << "Max"
+                  << "Mean"
+                  << "Std dev" << fort::endr;
+
+            for (auto const& code : codes) {
+                auto const stats = compute_range_stats(
+                    history, code, base, from_index, to_index);
+
+                table << code << stats.count;
+                for (auto const value : {stats.first,
+                                         stats.last,
+                                         stats.min,
+                                         stats.max,
+                                         stats.mean,
+                                         stats.stddev}) {
+                    table << (stats.count ? float_to_fixed_to_string(
+                                  value, DEFAULT_DECIMAL_POINTS_NUMBER)
+                                          : "");
+                }
+                table << fort::endr;
+            }
+        } else {
+            auto const days_count = to_index - from_index;
+
+            // one column per currency, NaN where a currency has no rate yet
+            std::vector<std::vector<double>> columns;
+            for (auto const& code : codes) {
+                columns.emplace_back(days_count, std::nan(""));
+                auto& column = columns.back();
+
+                history.for_each_cross_rate_chunk(
+                    code,
+                    base,
+                    from_index,
+                    to_index,
+                    [&](double const* rates, int const count, int const index) {
+                        std::copy(rates,
+                                  rates + count,
+                                  column.begin() + (index - from_index));
+                    });
+            }
+
+            table << fort::header << "Date";
+            for (auto const& code : codes) {
+                table << code;
+            }
+            table << fort::endr;
+
+            for (auto day = 0; day < days_count; day++) {
+                table << days_to_date(history.day(from_index + day));
+                for (auto const& column : columns) {
+                    table << (std::isnan(column[day])
+                                  ? ""
+                                  : float_to_fixed_to_string(
+                                      column[day],
+                                      DEFAULT_DECIMAL_POINTS_NUMBER));
+                }
+                table << fort::endr;
+            }
+        }
+
+        set_table_style(table);
+        for (auto column = 1; column < (int)table.col_count(); column++) {
+            table.column(column).set_cell_text_align(fort::text_align::right);
+        }
+
+        print(table.to_string() + "\n");
+    }
+
+    auto print_rate_matrix(std::vector<std::string> const& args) -> void
+    {
+        auto const args_size = (int)args.size();
+
+        auto format = rate_matrix_format::table;
+        auto tables = std::string{};
+
+        auto const formats = std::map<std::string, rate_matrix_format>{
+            {"CSV", rate_matrix_format::csv},
+            {"JSONL", rate_matrix_format::jsonl},
+            {"TABLE", rate_matrix_format::table}};
+
+        std::vector<std::string> codes;
+        for (auto i = 1; i < args_size; i++) {
+            auto format_name = std::string{};
+            if (args[i].rfind("--FORMAT=", 0) == 0) {
+                format_name = args[i].substr(9);
+            } else if ((args[i] == "-F" || args[i] == "--FORMAT")
+                       && i + 1 < args_size) {
+                format_name = args[++i];
+            } else if ((args[i] == "-T" || args[i] == "--TABLES")
+                       && i + 1 < args_size) {
+                tables = args[++i];
+                continue;
+            } else {
+                codes.push_back(args[i]);
+                continue;
+            }
+
+            auto const it = formats.find(format_name);
+            if (it == formats.end()) {
+                print_incorrect_command_usage_string("matrix");
+                return;
+            }
+            format = it->second;
+        }
+
+        std::vector<std::string> unknown_currency_codes;
+        for (auto const& code : codes) {
+            if (!is_correct_currency_code(code)) {
+                unknown_currency_codes.push_back(code);
+            }
+        }
+        if (print_list_error("Unknown currency codes: ",
+                             unknown_currency_codes)) {
+            return;
+        }
+
+        auto const snapshot = core.snapshot();
+        if (codes.empty()) {
+            for (auto const& rate : snapshot->rates()) {
+                codes.push_back(rate.code);
+            }
+        }
+
+        // PLN and the rates of the other sources come from no table, so
+        // they stay
+        if (!tables.empty()) {
+            auto const is_of_other_table = [&](std::string const& code) {
+                auto const table = snapshot->find(code)->table;
+                return table && tables.find(table) == std::string::npos;
+            };
+            codes.erase(
+                std::remove_if(codes.begin(), codes.end(), is_of_other_table),
+                codes.end());
+        }
+
+        std::vector<double> rates;
+        for (auto const& code : codes) {
+            rates.push_back(snapshot->find(code)->rate);
+        }
+
+        auto const writer = rate_matrix_writer{std::move(codes),
+                                               std::move(rates),
+                                               format,
+                                               DEFAULT_DECIMAL_POINTS_NUMBER};
+        writer.write(std::cout);
+    }
+
+    auto print_rolling_rates(std::vector<std::string> const& args) -> void
+    {
+        auto const rates = core.snapshot();
+
+        auto codes = std::vector<std::string>(args.begin() + 1, args.end());
+        if (codes.empty()) {
+            codes = rates->rolling_codes();
+        }
+
+        std::vector<std::string> unknown_currency_codes;
+        for (auto const& code : codes) {
+            if (!rates->rolling(code)) {
+                unknown_currency_codes.push_back(code);
+            }
+        }
+        if (print_list_error("Unknown currency codes: ",
+                             unknown_currency_codes)) {
+            return;
+        }
+
+        fort::utf8_table table;
+
+        table << fort::header << "Currency";
+        for (auto const& days : ROLLING_STATS_WINDOW_DAYS) {
+            auto const window = std::to_string(days) + " days";
+            table << "Mean " + window << "Volatility " + window;
+        }
+        table << fort::endr;
+
+        for (auto const& code : codes) {
+            table << code;
+            for (auto i = 0; i < ROLLING_STATS_WINDOWS_COUNT; i++) {
+                auto const stats = rates->rolling(code)->stats(i);
+
+                // a window shorter than its length is marked with its size
+                auto mean = float_to_fixed_to_string(
+                    stats.mean, DEFAULT_DECIMAL_POINTS_NUMBER);
+                if (stats.days < ROLLING_STATS_WINDOW_DAYS[i]) {
+                    mean += " (" + std::to_string(stats.days) + ")";
+                }
+
+                // two returns are the least a deviation says anything about
+                auto volatility = std::string{};
+                if (stats.days > 2) {
+                    volatility =
+                        float_to_fixed_to_string(stats.volatility * 100, 2)
+                        + "%";
+                }
+
+                table << mean << volatility;
+            }
+            table << fort::endr;
+        }
+
+        set_table_style(table);
+        for (auto column = 1; column < (int)table.col_count(); column++) {
+            table.column(column).set_cell_text_align(fort::text_align::right);
+        }
+
+        print(table.to_string() + "\n");
+    }
+
+    auto print_publication_date(bool const print_tables = false) -> void
+    {
+        auto const rates = core.snapshot();
+
+        print(rates->publication_date() + "\n");
+
+        // effective date and rates count of every table
+        std::map<char, std::pair<std::string, int>> tables;
+        for (auto const& rate : rates->rates()) {
+            if (rate.table) {
+                tables[rate.table].first = rate.effective_date;
+                tables[rate.table].second++;
+            }
+        }
+        for (auto const& rate : rates->bid_ask_rates()) {
+            if (rate.table) {
+                tables[rate.table].first = rate.effective_date;
+                tables[rate.table].second++;
+            }
+        }
+
+        if (!print_tables || tables.empty()) {
+            return;
+        }
+
+        fort::utf8_table table;
+        table << fort::header << "Table"
+              << "Effective date"
+              << "Rates" << fort::endr;
+        for (auto const& [letter, date_and_count] : tables) {
+            table << std::string(1, letter) << date_and_count.first
+                  << date_and_count.second << fort::endr;
+        }
+
+        set_table_style(table);
+        table.column(2).set_cell_text_align(fort::text_align::right);
+
+        print(table.to_string() + "\n");
+    }
+
+    static auto request_daemon_stop(int) -> void
+    {
+        daemon_stop_requested = 1;
+    }
+
+    static auto request_daemon_report(int) -> void
+    {
+        daemon_report_requested = 1;
+    }
+
+    // Updates the rates every interval until SIGINT or SIGTERM. The rates
+    // are published into the shared memory segment by the core after every
+    // update, so other processes read them without asking.
+    auto run_daemon(std::vector<std::string> const& args) -> void
+    {
+        auto const args_size = (int)args.size();
+
+        auto silent_mode = bool{false};
+        auto interval_s  = DAEMON_DEFAULT_INTERVAL_S;
+        for (auto i = 1; i < args_size; i++) {
+            if (args[i] == "-S" || args[i] == "--SILENT-MODE") {
+                silent_mode = true;
+            } else if ((args[i] == "-I" || args[i] == "--INTERVAL")
+                       && i + 1 < args_size) {
+                try {
+                    interval_s = std::stoi(args[++i]);
+                } catch (...) {
+                    interval_s = 0;
+                }
+            } else {
+                interval_s = 0;
+            }
+        }
+
+        if (interval_s < 1) {
+            print_incorrect_command_usage_string("daemon");
+            return;
+        }
+
+        // the rates of the first fetch are in use already
+        if (!error_strings.empty()) {
+            if (!silent_mode) {
+                print("Fetching data has failed!\n", color::red);
+                print_error_strings();
+            }
+            error_strings.clear();
+        }
+
+        auto const update_args =
+            silent_mode ? std::vector<std::string>{"UPDATE", "-S"}
+                        : std::vector<std::string>{"UPDATE"};
+        auto const interval = std::chrono::seconds{interval_s};
+
+        daemon_stop_requested   = 0;
+        daemon_report_requested = 0;
+        std::signal(SIGINT, request_daemon_stop);
+        std::signal(SIGTERM, request_daemon_stop);
+#ifdef SIGUSR1
+        std::signal(SIGUSR1, request_daemon_report);
+#endif
+
+        auto next_update = std::chrono::steady_clock::now() + interval;
+        while (!daemon_stop_requested) {
+            if (daemon_report_requested) {
+                daemon_report_requested = 0;
+                print_fetch_stats();
+                print_rolling_rates({"ROLLING"});
+            }
+
+            if (std::chrono::steady_clock::now() >= next_update) {
+                update_data(update_args);
+                core.wait_pending_tables();
+                next_update = std::chrono::steady_clock::now() + interval;
+            }
+
+            std::this_thread::sleep_for(DAEMON_POLL_INTERVAL);
+        }
+
+        std::signal(SIGINT, SIG_DFL);
+        std::signal(SIGTERM, SIG_DFL);
+#ifdef SIGUSR1
+        std::signal(SIGUSR1, SIG_DFL);
+#endif
+
+        if (!silent_mode) {
+            print("Bye!\n");
+        }
     }
 
     auto update_data(std::vector<std::string> const& args) -> void
@@ -614,8 +1374,21 @@ struct currency_converter {
         fetch_data();
 
         if (error_strings.empty()) {
+            if (rates_stale) {
+                if (!silent_mode) {
+                    print_stale_rates_warning();
+                }
+                return;
+            }
+
             if (!silent_mode) {
                 print("Data update successful!\n", color::green);
+
+                auto const& provider_name = core.snapshot()->provider_name();
+                if (provider_name != core.provider_names().front()) {
+                    print("Exchange rates provided by " + provider_name + "\n",
+                          color::yellow);
+                }
             }
             return;
         }
@@ -628,8 +1401,30 @@ struct currency_converter {
         error_strings.clear();
     }
 
-    auto print_currency_conversion(std::vector<std::string> const& args) -> void
+    auto print_currency_conversion(std::vector<std::string> args) -> void
     {
+        // the only option allowed anywhere after "to"
+        auto const bid_ask_index =
+            vector_index_of(args, std::string{"--BIDASK"});
+        auto const convert_at_bid_ask = bool{bid_ask_index != -1};
+        if (convert_at_bid_ask) {
+            args.erase(args.begin() + bid_ask_index);
+        }
+
+        auto rates      = std::shared_ptr<rates_snapshot const>{};
+        auto table_date = std::string{};
+        if (!take_dated_rates(args, rates, table_date)) {
+            return;
+        }
+        auto const is_dated = bool{!table_date.empty()};
+        auto const& best_routes = rates->best_routes();
+
+        // only the bid and ask rates of the latest table are kept
+        if (is_dated && convert_at_bid_ask) {
+            print_incorrect_command_usage_string("to");
+            return;
+        }
+
         auto const args_size = (int)args.size();
 
         auto const command_index = vector_index_of(args, std::string{"TO"});
@@ -733,54 +1528,86 @@ struct currency_converter {
         }
 
 
-        if (!unknown_currency_codes.empty()) {
-            print("Unknown currency codes: ", color::red);
-            auto const unknown_currency_codes_size =
-                (int)unknown_currency_codes.size();
-            auto currency_index = int{0};
-            for (auto const& currency : unknown_currency_codes) {
-                print(currency, color::red);
+        if (print_list_error("Unknown currency codes: ",
+                             unknown_currency_codes)) {
+            return;
+        }
 
-                if (currency_index + 1 < unknown_currency_codes_size) {
-                    print(", ", color::red);
+        if (convert_at_bid_ask) {
+            std::vector<std::string> unquoted_currency_codes;
+            for (auto const& [currency, value] : input_currencies) {
+                if (!best_routes.has_currency(currency)) {
+                    unquoted_currency_codes.push_back(currency);
                 }
+            }
+            if (!best_routes.has_currency(target_currency)) {
+                unquoted_currency_codes.push_back(target_currency);
+            }
 
-                currency_index++;
+            if (print_list_error("No bid and ask rates of: ",
+                                 unquoted_currency_codes)) {
+                return;
             }
-            print("\n");
+        }
+
+        if (is_dated) {
+            auto codes = std::vector<std::string>{target_currency};
+            for (auto const& [currency, value] : input_currencies) {
+                codes.push_back(currency);
+            }
+
+            if (print_missing_dated_rates(codes, *rates, table_date)) {
+                return;
+            }
+        }
+
+        if (print_currency_names
+            && !print_load_currency_names_error(currency_names_language)) {
             return;
         }
 
         auto result_value = float{0};
         for (auto const& [currency, value] : input_currencies) {
-            result_value += convert_currency(value, currency, target_currency);
+            if (convert_at_bid_ask) {
+                auto converted = double{0};
+                best_routes.convert(
+                    value, currency, target_currency, converted);
+                result_value += (float)converted;
+            } else {
+                result_value +=
+                    rates->convert(value, currency, target_currency).value;
+            }
         }
 
         auto const result_value_string = float_to_fixed_to_string(
-            result_value, DEFAULT_DECIMAL_POINTS_NUMBER);
+            result_value, amount_decimal_points(target_currency));
 
         if (print_result_only) {
             print(result_value_string + "\n");
         } else {
+            if (is_dated) {
+                print("Rates of the table published on " + table_date + "\n");
+            }
+
+            auto const names = currency_names_snapshot();
+            auto const language_id =
+                names->language_id(currency_names_language);
+            auto currency_name = std::string_view{};
+
             auto const input_currencies_size = (int)input_currencies.size();
             auto currency_index              = int{0};
             for (auto const& [currency, value] : input_currencies) {
                 auto const value_string = float_to_fixed_to_string(
-                    value, DEFAULT_DECIMAL_POINTS_NUMBER);
+                    value, amount_decimal_points(currency));
 
                 print(value_string, " ", currency, color::yellow);
 
                 if (print_currency_names) {
-                    auto currency_name = std::string{};
-                    if (currency_names[currency_names_language].count(
-                            currency)) {
-                        currency_name =
-                            currency_names[currency_names_language][currency];
-                    } else {
+                    if (!names->find(language_id, currency, currency_name)) {
                         currency_name = "???";
                     }
 
-                    print("(" + currency_name + ")");
+                    print("(" + std::string{currency_name} + ")");
                 }
 
                 if (currency_index == input_currencies_size - 1) {
@@ -799,29 +1626,47 @@ struct currency_converter {
                   color::yellow);
 
             if (print_currency_names) {
-                auto currency_name = std::string{};
-                if (currency_names[currency_names_language].count(
-                        target_currency)) {
-                    currency_name = currency_names[currency_names_language]
-                                                  [target_currency];
-                } else {
+                if (!names->find(language_id, target_currency, currency_name)) {
                     currency_name = "???";
                 }
 
-                print("(" + currency_name + ")");
+                print("(" + std::string{currency_name} + ")");
             }
 
             print("\n");
+
+            if (convert_at_bid_ask) {
+                for (auto const& [currency, value] : input_currencies) {
+                    auto const route =
+                        best_routes.route(currency, target_currency);
+
+                    print("Route: ");
+                    for (auto i = 0; i < (int)route.size(); i++) {
+                        print(route[i], color::yellow);
+                        if (i + 1 < (int)route.size()) {
+                            print(" -> ");
+                        }
+                    }
+                    print("\n");
+                }
+            }
         }
     }
 
-    auto make_currency_table(std::string const& base_currency,
+    // The libfort table of the "table" command, which the core renders
+    // without libfort where it can, see currency_converter_core::render_table
+    auto make_currency_table(rates_snapshot const& rates,
+                             std::string const& base_currency,
                              std::vector<std::string> const& target_currencies,
                              std::string const& currency_names_language)
         -> fort::utf8_table
     {
         auto const show_currency_names = bool{!currency_names_language.empty()};
 
+        std::vector<currency_table_entry> rows;
+        rates.table_rows(
+            base_currency, target_currencies, currency_names_language, rows);
+
         fort::utf8_table table;
         table << fort::header;
         table << "Currency";
@@ -831,23 +1676,13 @@ struct currency_converter {
         table << "Rate";
         table << fort::endr;
 
-        for (auto const& currency : target_currencies) {
-            if (currency == base_currency) {
-                continue;
-            }
-
-            table << currency;
+        for (auto const& row : rows) {
+            table << row.code;
             if (show_currency_names) {
-                if (currency_names[currency_names_language].count(currency)) {
-                    table << currency_names[currency_names_language][currency];
-                } else {
-                    table << "";
-                }
+                table << row.name;
             }
 
-            auto const rate = convert_currency(1, currency, base_currency);
-
-            table << float_to_fixed_to_string(rate,
+            table << float_to_fixed_to_string(row.rate,
                                               DEFAULT_DECIMAL_POINTS_NUMBER);
             table << fort::endr;
         }
@@ -874,8 +1709,14 @@ struct currency_converter {
         return table;
     }
 
-    auto print_currency_table(std::vector<std::string> const& args) -> void
+    auto print_currency_table(std::vector<std::string> args) -> void
     {
+        auto rates      = std::shared_ptr<rates_snapshot const>{};
+        auto table_date = std::string{};
+        if (!take_dated_rates(args, rates, table_date)) {
+            return;
+        }
+
         auto const args_size = (int)args.size();
 
         if (args_size == 1) {
@@ -958,33 +1799,58 @@ struct currency_converter {
                 }
             }
 
-            if (!unknown_currency_codes.empty()) {
-                print("Unknown currency codes: ", color::red);
-                auto const unknown_currency_codes_size =
-                    (int)unknown_currency_codes.size();
-                auto currency_index = int{0};
-                for (auto const& currency : unknown_currency_codes) {
-                    print(currency, color::red);
+            if (print_list_error("Unknown currency codes: ",
+                                 unknown_currency_codes)) {
+                return;
+            }
+        }
 
-                    if (currency_index + 1 < unknown_currency_codes_size) {
-                        print(", ", color::red);
-                    }
+        // no targets stand for every currency of the rates
+        if (!table_date.empty()) {
+            auto codes = target_currencies;
+            codes.push_back(base_currency);
 
-                    currency_index++;
-                }
-                print("\n");
+            if (print_missing_dated_rates(codes, *rates, table_date)) {
                 return;
             }
-        } else {
-            for (auto const& [currency, rate] : exchange_rates) {
-                target_currencies.push_back(currency);
+        }
+
+        if (!currency_names_language.empty()) {
+            if (!print_load_currency_names_error(currency_names_language)) {
+                return;
             }
+
+            // the names fetched just now are only in a newer snapshot
+            rates = table_date.empty()
+                        ? core.snapshot()
+                        : core.snapshot()->on_day(date_to_days(table_date));
+        }
+
+        if (!table_date.empty()) {
+            print("Rates of the table published on " + table_date + "\n");
         }
 
-        auto const table = make_currency_table(
-            base_currency, target_currencies, currency_names_language);
+        auto text = std::string{};
+        if (!core.render_table(*rates,
+                               base_currency,
+                               target_currencies,
+                               currency_names_language,
+                               DEFAULT_DECIMAL_POINTS_NUMBER,
+                               text)) {
+            text = make_currency_table(*rates,
+                                       base_currency,
+                                       target_currencies,
+                                       currency_names_language)
+                       .to_string();
+            core.keep_table(*rates,
+                            base_currency,
+                            target_currencies,
+                            currency_names_language,
+                            DEFAULT_DECIMAL_POINTS_NUMBER,
+                            text);
+        }
 
-        print(table.to_string() + "\n");
+        print(text + "\n");
     }
 
     auto await_commands() -> void
@@ -1008,11 +1874,34 @@ struct currency_converter {
   public:
     currency_converter()
     {
+        core.load_history();
         fetch_data();
     }
 
+    // loads the given table instead of fetching one
+    explicit currency_converter(rate_table const& table)
+    {
+        core.load(table);
+    }
+
+    // see currency_converter_core::share_rates()
+    auto share_rates() -> void
+    {
+        core.share_rates();
+    }
+
     auto read_command_line(std::string line) -> void
     {
+        // every command sees the NBP tables B and C of the last update
+        core.wait_pending_tables();
+
+        // the daemon goes on trying to fetch the rates
+        if (auto const args = string_to_vector(string_to_uppercase(line));
+            !args.empty() && args[0] == "DAEMON") {
+            run_daemon(args);
+            return;
+        }
+
         if (!error_strings.empty()) {
             print_error_strings();
             return;
@@ -1024,6 +1913,8 @@ struct currency_converter {
             line = line.substr(etet_index + 4, line.size() - etet_index - 3);
         }
 
+        auto const raw_args = string_to_vector(line);
+
         line      = string_to_uppercase(line);
         auto args = string_to_vector(line);
 
@@ -1041,9 +1932,17 @@ struct currency_converter {
             return;
         }
 
+        if (args[0] == "BACKFILL") {
+            backfill_history(args);
+            return;
+        }
+
         if (args[0] == "DATE") {
             if (args.size() == 1) {
                 print_publication_date();
+            } else if (args.size() == 2
+                       && (args[1] == "-T" || args[1] == "--TABLES")) {
+                print_publication_date(true);
             } else {
                 print_incorrect_command_usage_string("date");
             }
@@ -1061,7 +1960,7 @@ struct currency_converter {
         }
 
         if (args[0] == "FETCHLANG") {
-            fetch_additional_currency_names_language(args);
+            fetch_additional_currency_names_language(args, raw_args);
             return;
         }
 
@@ -1074,6 +1973,30 @@ struct currency_converter {
             return;
         }
 
+        if (args[0] == "MATRIX") {
+            print_rate_matrix(args);
+            return;
+        }
+
+        if (args[0] == "RANGE") {
+            print_range_rates(args);
+            return;
+        }
+
+        if (args[0] == "ROLLING") {
+            print_rolling_rates(args);
+            return;
+        }
+
+        if (args[0] == "STATS") {
+            if (args.size() == 1) {
+                print_fetch_stats();
+            } else {
+                print_incorrect_command_usage_string("stats");
+            }
+            return;
+        }
+
         if (args[0] == "TABLE") {
             print_currency_table(args);
             return;
@@ -1110,6 +2033,10 @@ struct currency_converter {
         print_logo();
         print("Type \"help\" to see the complete list of commands\n");
 
+        if (rates_stale) {
+            print_stale_rates_warning();
+        }
+
         await_commands();
     }
 
@@ -0,0 +1,173 @@
+/*
+console NBP currency converter
+
+MIT License
+
+Copyright (c) 2021 Kajetan Welc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+/*
+C interface of the converter library for other languages, over
+currency_converter_core.h. Every name is prefixed with ncc_.
+
+A snapshot handle holds one published set of rates and names. It is reference
+counted and stays valid, unchanged, until its last reference is released, even
+while ncc_converter_refresh() publishes newer snapshots on another thread. The
+strings it hands out live as long as the snapshot.
+
+The conversions and the iterator write into memory owned by the caller and
+allocate nothing, so they may be called from hot loops. Only creating a
+converter, refreshing it, setting names and taking the snapshot of a new
+version allocate.
+*/
+
+#ifndef CURRENCY_CONVERTER_C_H
+#define CURRENCY_CONVERTER_C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// bumped whenever the layout of a struct or the meaning of a call changes
+#define NCC_ABI_VERSION 2
+
+
+typedef enum ncc_status {
+    NCC_OK               = 0,
+    NCC_UNKNOWN_CURRENCY = 1,
+    NCC_UNKNOWN_LANGUAGE = 2,
+    NCC_FETCH_FAILED     = 3,
+    NCC_INVALID_ARGUMENT = 4,
+    NCC_OUT_OF_MEMORY    = 5,
+    NCC_STALE_RATES      = 6
+} ncc_status;
+
+
+typedef struct ncc_converter ncc_converter;
+typedef struct ncc_snapshot ncc_snapshot;
+
+
+typedef struct ncc_rate {
+    // NUL terminated
+    char const* code;
+    char const* effective_date;
+
+    // value of one unit in PLN
+    float rate;
+
+    // letter of the NBP table the rate comes from, 0 for PLN and the other
+    // sources
+    char table;
+
+    // UTF-8, not NUL terminated; NULL if there is no name in the language
+    char const* name;
+    size_t name_length;
+} ncc_rate;
+
+
+// Walks the rates of a snapshot in the order of their codes. It is kept by
+// the caller and holds no reference, so the snapshot has to outlive it.
+typedef struct ncc_rate_iterator {
+    ncc_snapshot const* snapshot;
+    int language_id;
+    size_t index;
+} ncc_rate_iterator;
+
+
+// NCC_ABI_VERSION of the library, to compare with the header in use
+int ncc_abi_version(void);
+
+// The rate sources are read from the same environment variables as the
+// command line. Nothing is fetched yet. NULL if the converter cannot be made.
+ncc_converter* ncc_converter_new(void);
+
+// the snapshots taken from the converter stay valid after it is freed
+void ncc_converter_free(ncc_converter* converter);
+
+// Fetches the rates and publishes them as a new snapshot. May be called on
+// any thread. Returns once the NBP tables B and C are in as well, or have
+// failed. NCC_STALE_RATES if every source failed and the snapshot holds the
+// newest table of NBP_CONVERTER_CACHE_DIR instead.
+ncc_status ncc_converter_refresh(ncc_converter* converter);
+
+// Sets the names of count currencies in a language, e.g. "EN".
+ncc_status ncc_converter_set_currency_names(ncc_converter* converter,
+                                            char const* language_code,
+                                            char const* const* currency_codes,
+                                            char const* const* names,
+                                            size_t count);
+
+// The newest snapshot with a reference for the caller, NULL if out of memory.
+// Only holds PLN before the first refresh.
+ncc_snapshot* ncc_converter_snapshot(ncc_converter* converter);
+
+void ncc_snapshot_retain(ncc_snapshot* snapshot);
+void ncc_snapshot_release(ncc_snapshot* snapshot);
+
+// greater for every snapshot published after this one
+uint64_t ncc_snapshot_version(ncc_snapshot const* snapshot);
+
+// NUL terminated, empty before the first refresh
+char const* ncc_snapshot_publication_date(ncc_snapshot const* snapshot);
+
+size_t ncc_snapshot_rates_count(ncc_snapshot const* snapshot);
+
+ncc_status ncc_convert(ncc_snapshot const* snapshot,
+                       float value,
+                       char const* from_code,
+                       char const* to_code,
+                       float* result);
+
+// results[i] is values[i] of from_codes[i] in the target currency. statuses
+// may be NULL; otherwise statuses[i] tells whether results[i] is set. Returns
+// the first status that is not NCC_OK.
+ncc_status ncc_convert_batch(ncc_snapshot const* snapshot,
+                             float const* values,
+                             char const* const* from_codes,
+                             size_t count,
+                             char const* to_code,
+                             float* results,
+                             ncc_status* statuses);
+
+// the same for values all in one currency
+ncc_status ncc_convert_values(ncc_snapshot const* snapshot,
+                              float const* values,
+                              size_t count,
+                              char const* from_code,
+                              char const* to_code,
+                              float* results);
+
+// language_code may be NULL to leave the names out
+ncc_status ncc_rate_iterator_init(ncc_rate_iterator* iterator,
+                                  ncc_snapshot const* snapshot,
+                                  char const* language_code);
+
+// 1 after filling rate, 0 once every rate has been walked
+int ncc_rate_iterator_next(ncc_rate_iterator* iterator, ncc_rate* rate);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
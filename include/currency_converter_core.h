@@ -0,0 +1,421 @@
+/*
+console NBP currency converter
+
+MIT License
+
+Copyright (c) 2021 Kajetan Welc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+The currency converter without its command line. The core loads or fetches the
+exchange rates and publishes them with the currency names, the rates history
+and its rolling statistics as an immutable snapshot; the conversions and table
+rows are worked out from a snapshot and returned as values, and nothing is
+printed. A snapshot taken once stays usable for as long as it is held, whatever
+is loaded after it.
+
+The core also fetches the currency names of other languages, backfills the
+history, renders the currency tables and publishes the rates into the shared
+memory of the host, see shared_rates.h.
+
+It is built into build/libcurrency_converter.a and .so (see the Makefile).
+currency_converter.h, the command line, is a front end over it that parses the
+commands and prints the results.
+*/
+
+#ifndef CURRENCY_CONVERTER_CORE_H
+#define CURRENCY_CONVERTER_CORE_H
+
+#include <currency_names.h>
+#include <currency_rate.h>
+#include <currency_table_renderer.h>
+#include <fetch_stats.h>
+#include <iso4217.h>
+#include <rate_history.h>
+#include <rendered_table_cache.h>
+#include <rolling_stats.h>
+#include <shared_rates.h>
+#include <task_result.h>
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+
+// see rate_providers.h and bid_ask_routes.h
+struct rate_table;
+struct rate_provider;
+struct pending_rate_tables;
+struct bid_ask_routes;
+
+
+enum class converter_status { ok, unknown_currency, unknown_language };
+
+
+struct conversion_amount {
+    std::string code;
+    float value = 0;
+};
+
+
+struct conversion_result {
+    float value             = 0;
+    converter_status status = converter_status::ok;
+};
+
+
+// one row of a currency table: the value of one unit of code in the base
+struct currency_table_entry {
+    std::string code;
+    std::string name;
+    float rate = 0;
+};
+
+
+struct rates_snapshot {
+  private:
+    friend struct currency_converter_core;
+
+    std::uint64_t snapshot_version = 0;
+    std::string date;
+    std::string provider;
+
+    // both sorted by code
+    std::vector<currency_rate> currency_rates;
+    std::vector<currency_bid_ask> currency_bid_asks;
+
+    // index into currency_rates by ISO 4217 id, -1 where there is no rate
+    std::array<std::int16_t, ISO4217_CURRENCIES_COUNT> rate_indices;
+
+    std::shared_ptr<currency_name_table const> names;
+
+    // every table applied so far, and the moving statistics of its columns
+    // with one push per day; shared by the snapshots until the next table
+    std::shared_ptr<rate_history const> rates_history;
+    std::shared_ptr<
+        std::map<std::string, currency_rolling_stats, std::less<>> const>
+        rolling_rates;
+
+    // solved once per table for the conversions at the bid and ask rates
+    std::shared_ptr<bid_ask_routes const> routes;
+
+    // sorts the rates by code and fills rate_indices
+    auto index_rates() -> void;
+
+  public:
+    rates_snapshot();
+
+    // greater for every snapshot published after this one
+    auto version() const -> std::uint64_t;
+
+    auto publication_date() const -> std::string const&;
+
+    // the rate source that answered, empty for a loaded table
+    auto provider_name() const -> std::string const&;
+
+    auto rates() const -> std::vector<currency_rate> const&;
+    auto bid_ask_rates() const -> std::vector<currency_bid_ask> const&;
+    auto currency_names() const
+        -> std::shared_ptr<currency_name_table const> const&;
+
+    // nullptr if there is no rate of the code
+    auto find(std::string_view code) const -> currency_rate const*;
+
+    auto convert(float value, std::string_view from, std::string_view to) const
+        -> conversion_result;
+
+    // results[i] is amounts[i] in the target currency
+    auto convert_batch(std::vector<conversion_amount> const& amounts,
+                       std::string_view to,
+                       std::vector<conversion_result>& results) const -> void;
+
+    // Every target except the base itself, or every currency if there are no
+    // targets. The names are left empty without a language.
+    auto table_rows(std::string_view base,
+                    std::vector<std::string> const& targets,
+                    std::string const& language,
+                    std::vector<currency_table_entry>& rows) const
+        -> converter_status;
+
+    auto history() const -> rate_history const&;
+
+    // nullptr if the history has no rates of the code
+    auto rolling(std::string_view code) const -> currency_rolling_stats const*;
+
+    // the codes with rolling statistics, sorted
+    auto rolling_codes() const -> std::vector<std::string>;
+
+    // see bid_ask_routes.h
+    auto best_routes() const -> bid_ask_routes const&;
+
+    // The rates in force on the day, in days since 1970-01-01, taken from the
+    // history as a snapshot of the same version and names published on the
+    // date of that table, without bid and ask rates. nullptr if no table was
+    // in force on the day.
+    auto on_day(int day) const -> std::shared_ptr<rates_snapshot const>;
+};
+
+
+// where the rates are fetched from, see converter_sources::from_env()
+struct converter_sources {
+    std::string nbp_base_url;
+    std::string ecb_base_url;
+
+    // the API of the English currency names
+    std::string names_base_url;
+
+    // saved tables, both may be empty; the cache directory keeps the rates
+    // history too, see currency_converter_core::load_history()
+    std::string rates_path;
+    std::string cache_dir;
+
+    // NBP_CONVERTER_NBP_BASE_URL, NBP_CONVERTER_ECB_BASE_URL,
+    // NBP_CONVERTER_NAMES_BASE_URL, NBP_CONVERTER_RATES_PATH and
+    // NBP_CONVERTER_CACHE_DIR, or the public APIs
+    static auto from_env() -> converter_sources;
+};
+
+
+struct refresh_result {
+    bool ok = false;
+    std::string provider_name;
+
+    // the table is an old one from the cache, as every other source failed
+    bool stale = false;
+
+    // the errors of the sources that failed
+    std::vector<std::string> errors;
+
+    std::vector<fetch_record> records;
+};
+
+
+struct backfill_result {
+    // days put into the history
+    int added_count = 0;
+
+    // every attempt of every range, 0 if the history held all the days
+    int requests_count = 0;
+
+    // "FROM - TO: error" of every range that failed
+    std::vector<std::string> errors;
+};
+
+
+struct currency_converter_core {
+  private:
+    // src/bench.cpp measures the private hot paths
+    friend struct currency_converter_bench;
+
+    converter_sources const config;
+    std::vector<std::shared_ptr<rate_provider>> providers;
+
+    // the API of every language whose names can be fetched
+    std::map<std::string, std::string> const names_urls;
+
+    // read through snapshot(), replaced under mtx
+    std::shared_ptr<rates_snapshot const> current;
+    std::mutex mtx;
+
+    // where the history is saved after every change, empty until
+    // load_history()
+    std::string history_path;
+
+    fetch_stats timings;
+
+    // the languages being fetched, so that the callers asking for the same
+    // language at the same time wait for a single fetch
+    std::map<std::string, std::shared_future<task_result<bool>>>
+        names_fetches;
+    std::mutex names_mtx;
+
+    // the rendered tables of the latest snapshot and the buffers every
+    // rendered table reuses
+    rendered_table_cache rendered_tables;
+    currency_table_renderer table_renderer;
+    std::vector<currency_table_row> table_rows;
+    std::mutex tables_mtx;
+
+    // see share_rates()
+    bool shares_rates = false;
+    shared_rates_writer shared_rates;
+
+    // the tables the last refresh() goes on fetching, and the task that
+    // publishes them
+    std::shared_ptr<pending_rate_tables> pending_tables;
+    std::future<void> pending_load;
+    std::mutex pending_mtx;
+
+    // the caller holds mtx
+    auto publish(std::shared_ptr<rates_snapshot> next) -> void;
+    auto publish_shared_rates() -> void;
+    auto save_history(rate_history const& history) const -> void;
+
+    // the history replaced by older days put in front of it, with its
+    // rolling statistics pushed again
+    auto replace_history(rate_history history) -> void;
+
+    // The caller holds mtx. The rates, the bid and ask rates and the names of
+    // the table replace those of next; the ones the table lacks are kept.
+    static auto merge_table(rates_snapshot& next, rate_table const& table)
+        -> void;
+
+    // The caller holds mtx. The NBP table A and B rates of the table are
+    // recorded on the newest of their effective dates: appended if it is
+    // newer than the last day of the history, merged into that day if it is
+    // the same, and left out if it is older. The rates of the other sources,
+    // e.g. ECB, are not recorded.
+    auto record_history(rates_snapshot& next, rate_table const& table) const
+        -> void;
+
+    // publishes the pending tables once they arrive, with the table they
+    // complete saved to the cache again
+    auto load_pending_tables(pending_rate_tables& pending, rate_table table)
+        -> void;
+
+    // cancels the pending tables and waits for them
+    auto cancel_pending_tables() -> void;
+
+    auto install_currency_names(
+        std::string const& language_code,
+        std::vector<std::pair<std::string, std::string>> const& names,
+        fetch_record& record) -> void;
+    auto fetch_and_install_currency_names(std::string const& language_code,
+                                          std::string const& url)
+        -> task_result<bool>;
+
+    static auto rendered_table_key(rates_snapshot const& rates,
+                                   std::string const& base,
+                                   std::vector<std::string> const& targets,
+                                   std::string const& language,
+                                   int decimal_points) -> std::string;
+
+  public:
+    explicit currency_converter_core(
+        converter_sources s = converter_sources::from_env());
+    ~currency_converter_core();
+
+    currency_converter_core(currency_converter_core const&) = delete;
+    auto operator=(currency_converter_core const&)
+        -> currency_converter_core& = delete;
+
+    auto sources() const -> converter_sources const&;
+
+    // the names of the rate sources, the preferred one first
+    auto provider_names() const -> std::vector<std::string>;
+
+    auto snapshot() const -> std::shared_ptr<rates_snapshot const>;
+
+    // Fetches the rates from every source at once and publishes the first
+    // valid table, which is also copied to fetched_table if given. The rates
+    // of currencies the table lacks are kept from the previous snapshot. The
+    // timings of every source are kept, see fetch_timings().
+    //
+    // The NBP tables B and C do not hold back table A: they are published in
+    // a newer snapshot from another thread once they arrive, see
+    // wait_pending_tables(). A refresh cancels the ones of the previous one.
+    auto refresh(rate_table* fetched_table = nullptr) -> refresh_result;
+
+    // Returns once the tables the last refresh() went on fetching have been
+    // published or have failed; at once if there are none.
+    auto wait_pending_tables() -> void;
+
+    // Publishes the table as refresh() does, with its Polish currency names as
+    // language "PL", and records its NBP table A and B rates in the history,
+    // see record_history(). provider_name tells where the table comes from.
+    auto load(rate_table const& table, std::string const& provider_name = "")
+        -> void;
+
+    // The names of other languages are kept. A later name of a currency
+    // replaces the earlier one, and every word of a name is capitalized.
+    auto set_currency_names(
+        std::string const& language_code,
+        std::vector<std::pair<std::string, std::string>> const& names) -> void;
+
+    // the timings of the fetches made so far
+    auto fetch_timings() const -> fetch_stats const&;
+
+    // Reads the history saved in the cache directory and saves the history
+    // there after every change from then on. Returns false if there is no
+    // cache directory or no saved history.
+    auto load_history() -> bool;
+
+    // Downloads the NBP tables A published between the days, in days since
+    // 1970-01-01, that the history lacks, see rate_backfill.h. The history is
+    // published and saved after every range, so a backfill that fails or is
+    // stopped keeps the ranges it got.
+    auto backfill(int from_day,
+                  int to_day,
+                  int jobs,
+                  double requests_per_second) -> backfill_result;
+
+    // the language is loaded or can be fetched
+    auto is_known_language(std::string const& language_code) -> bool;
+
+    // Makes sure the names of the language are there, fetching them on the
+    // first use. Callers asking for the same language at the same time wait
+    // for a single fetch, and a failed language is fetched again by the next
+    // call.
+    auto load_currency_names(std::string const& language_code)
+        -> task_result<bool>;
+
+    // Fetches the (language code, url) pairs on at most jobs threads. Each
+    // language is set as soon as it is parsed, so a failed one does not hold
+    // back the others. results[i] is the result of languages[i].
+    auto fetch_currency_names(
+        std::vector<std::pair<std::string, std::string>> const& languages,
+        int jobs) -> std::vector<task_result<bool>>;
+
+    // The table of the rows of rates.table_rows(), drawn as
+    // currency_table_renderer draws it, with the rates rounded to the
+    // decimal points. The tables are kept by their query until a newer
+    // snapshot is published. Returns false if a name has a display width
+    // the renderer cannot tell and keep_table() did not get the table.
+    auto render_table(rates_snapshot const& rates,
+                      std::string const& base,
+                      std::vector<std::string> const& targets,
+                      std::string const& language,
+                      int decimal_points,
+                      std::string& text) -> bool;
+
+    // keeps a table that render_table() could not draw, drawn by the caller
+    auto keep_table(rates_snapshot const& rates,
+                    std::string const& base,
+                    std::vector<std::string> const& targets,
+                    std::string const& language,
+                    int decimal_points,
+                    std::string text) -> void;
+
+    // Publishes the rates and their rolling statistics into the shared memory
+    // segment of the host now and after every change, see shared_rates.h.
+    // Only the command line program calls it, so the benchmarks and other
+    // converters leave the rates other processes read alone.
+    auto share_rates() -> void;
+};
+
+#endif
@@ -0,0 +1,291 @@
+/*
+console NBP currency converter
+
+MIT License
+
+Copyright (c) 2021 Kajetan Welc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+/*
+Currency names of every known language. All names live one after another in a
+single string, and a dense [language_id][currency_id] table holds where each
+of them starts and how many terminal columns it takes. A table is never changed
+once it is built; new names make a new table, so a reader may keep using the
+one it holds.
+*/
+
+#ifndef CURRENCY_NAMES_H
+#define CURRENCY_NAMES_H
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+
+// Terminal columns of UTF-8 text, counted like the wcwidth() of libfort. Only
+// code points that take exactly one column are known: printable ASCII and the
+// Latin, Greek and Cyrillic letters without combining marks. Returns -1 for
+// anything else, including malformed UTF-8.
+inline auto utf8_display_width(std::string_view const text) -> int
+{
+    auto width = 0;
+    for (auto i = std::size_t{0}; i < text.size(); width++) {
+        auto const byte = (unsigned char)text[i];
+
+        auto code_point = std::uint32_t{0};
+        auto length     = std::size_t{0};
+        if (byte < 0x80) {
+            code_point = byte;
+            length     = 1;
+        } else if ((byte & 0xe0) == 0xc0) {
+            code_point = byte & 0x1f;
+            length     = 2;
+        } else {
+            return -1;
+        }
+
+        if (i + length > text.size()) {
+            return -1;
+        }
+        for (auto j = i + 1; j < i + length; j++) {
+            if (((unsigned char)text[j] & 0xc0) != 0x80) {
+                return -1;
+            }
+            code_point = (code_point << 6) | ((unsigned char)text[j] & 0x3f);
+        }
+        i += length;
+
+        auto const is_single_column =
+            (code_point >= 0x20 && code_point <= 0x7e)
+            || (code_point >= 0xa0 && code_point <= 0x2ff)
+            || (code_point >= 0x370 && code_point <= 0x482)
+            || (code_point >= 0x48a && code_point <= 0x52f);
+        if (!is_single_column || (length == 2 && code_point < 0x80)) {
+            return -1;
+        }
+    }
+
+    return width;
+}
+
+
+struct currency_name_table {
+  private:
+    friend struct currency_name_table_builder;
+
+    static std::uint32_t const NO_NAME = UINT32_MAX;
+
+    struct name_ref {
+        std::uint32_t offset = NO_NAME;
+        std::uint32_t length = 0;
+        std::int32_t width   = 0;
+    };
+
+    // both sorted, so the ids follow the alphabetical order of the codes
+    std::vector<std::string> languages;
+    std::vector<std::string> currencies;
+
+    std::string arena;
+    std::vector<name_ref> refs;
+
+    static auto index_of(std::vector<std::string> const& codes,
+                         std::string const& code) -> int
+    {
+        auto const it = std::lower_bound(codes.begin(), codes.end(), code);
+        if (it == codes.end() || *it != code) {
+            return -1;
+        }
+
+        return (int)(it - codes.begin());
+    }
+
+  public:
+    auto language_id(std::string const& language_code) const -> int
+    {
+        return index_of(languages, language_code);
+    }
+
+    auto currency_id(std::string const& currency_code) const -> int
+    {
+        return index_of(currencies, currency_code);
+    }
+
+    auto language_codes() const -> std::vector<std::string> const&
+    {
+        return languages;
+    }
+
+    auto currency_codes() const -> std::vector<std::string> const&
+    {
+        return currencies;
+    }
+
+    auto has_name(int const language_id, int const currency_id) const -> bool
+    {
+        return refs[language_id * currencies.size() + currency_id].offset
+               != NO_NAME;
+    }
+
+    auto name(int const language_id, int const currency_id) const
+        -> std::string_view
+    {
+        auto const& ref = refs[language_id * currencies.size() + currency_id];
+        return std::string_view{arena}.substr(ref.offset, ref.length);
+    }
+
+    // utf8_display_width() of the name, worked out when the table was built
+    auto name_width(int const language_id, int const currency_id) const -> int
+    {
+        return refs[language_id * currencies.size() + currency_id].width;
+    }
+
+    // the language id comes from language_id(); false if there is no name
+    auto find(int const language_id,
+              std::string const& currency_code,
+              std::string_view& result) const -> bool
+    {
+        auto width = int{0};
+        return find(language_id, currency_code, result, width);
+    }
+
+    auto find(int const language_id,
+              std::string const& currency_code,
+              std::string_view& result,
+              int& width) const -> bool
+    {
+        if (language_id == -1) {
+            return false;
+        }
+
+        auto const id = currency_id(currency_code);
+        if (id == -1 || !has_name(language_id, id)) {
+            return false;
+        }
+
+        result = name(language_id, id);
+        width  = name_width(language_id, id);
+        return true;
+    }
+};
+
+
+struct currency_name_table_builder {
+  private:
+    struct entry {
+        std::string language;
+        std::string currency;
+        std::string name;
+    };
+
+    std::vector<entry> entries;
+
+  public:
+    currency_name_table_builder() = default;
+
+    // starts with every name of the table, so only the new ones are set
+    explicit currency_name_table_builder(currency_name_table const& base)
+    {
+        for (auto l = 0; l < (int)base.languages.size(); l++) {
+            for (auto c = 0; c < (int)base.currencies.size(); c++) {
+                if (base.has_name(l, c)) {
+                    entries.push_back({base.languages[l],
+                                       base.currencies[c],
+                                       std::string{base.name(l, c)}});
+                }
+            }
+        }
+    }
+
+    // a later name of the same language and currency replaces the earlier one
+    auto set(std::string language_code,
+             std::string currency_code,
+             std::string name) -> void
+    {
+        entries.push_back({std::move(language_code),
+                           std::move(currency_code),
+                           std::move(name)});
+    }
+
+    auto build() -> std::shared_ptr<currency_name_table const>
+    {
+        auto table = std::make_shared<currency_name_table>();
+
+        std::stable_sort(
+            entries.begin(), entries.end(), [](auto const& a, auto const& b) {
+                return std::tie(a.language, a.currency)
+                       < std::tie(b.language, b.currency);
+            });
+
+        for (auto const& each : entries) {
+            table->languages.push_back(each.language);
+            table->currencies.push_back(each.currency);
+        }
+        for (auto* codes : {&table->languages, &table->currencies}) {
+            std::sort(codes->begin(), codes->end());
+            codes->erase(std::unique(codes->begin(), codes->end()),
+                         codes->end());
+        }
+
+        table->refs.resize(table->languages.size()
+                           * table->currencies.size());
+
+        auto arena_size = std::size_t{0};
+        for (auto const& each : entries) {
+            arena_size += each.name.size();
+        }
+        table->arena.reserve(arena_size);
+
+        auto language_id = 0;
+        for (auto i = std::size_t{0}; i < entries.size(); i++) {
+            auto const& each = entries[i];
+
+            // only the last of the equal keys is kept
+            if (i + 1 < entries.size()
+                && entries[i + 1].language == each.language
+                && entries[i + 1].currency == each.currency) {
+                continue;
+            }
+
+            while (table->languages[language_id] != each.language) {
+                language_id++;
+            }
+
+            auto& ref = table->refs[language_id * table->currencies.size()
+                                    + table->currency_id(each.currency)];
+            ref.offset = (std::uint32_t)table->arena.size();
+            ref.length = (std::uint32_t)each.name.size();
+            ref.width  = utf8_display_width(each.name);
+
+            table->arena += each.name;
+        }
+
+        entries.clear();
+
+        return table;
+    }
+};
+
+#endif
@@ -0,0 +1,82 @@
+/*
+console NBP currency converter
+
+MIT License
+
+Copyright (c) 2021 Kajetan Welc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+/*
+The rates of one currency as the rate tables and the snapshots of the converter
+hold them. Both keep them in vectors sorted by code, which for the ISO 4217
+codes is also the order of their ids, see iso4217.h.
+*/
+
+#ifndef CURRENCY_RATE_H
+#define CURRENCY_RATE_H
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+
+struct currency_rate {
+    std::string code;
+
+    // value of one unit in PLN
+    float rate = 0;
+
+    // letter of the NBP table the rate comes from, 0 for PLN and the other
+    // sources
+    char table = 0;
+    std::string effective_date;
+};
+
+
+struct currency_bid_ask {
+    std::string code;
+    float bid = 0;
+    float ask = 0;
+
+    // the NBP table C they come from
+    char table = 0;
+    std::string effective_date;
+};
+
+
+// Sorts the items by their code member and keeps the first of the items with
+// the same code, so a stable order of the input decides which one wins.
+template<typename T, typename Code>
+auto sort_unique_by_code(std::vector<T>& items, Code T::*code) -> void
+{
+    std::stable_sort(
+        items.begin(), items.end(), [&](T const& a, T const& b) {
+            return a.*code < b.*code;
+        });
+
+    auto const same_code = [&](T const& a, T const& b) {
+        return a.*code == b.*code;
+    };
+    items.erase(std::unique(items.begin(), items.end(), same_code),
+                items.end());
+}
+
+#endif
@@ -0,0 +1,242 @@
+/*
+console NBP currency converter
+
+MIT License
+
+Copyright (c) 2021 Kajetan Welc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+Renderer of the one layout of the "table" command (Currency, optional Name and
+Rate columns) that writes the borders and cells straight into one string. Its
+output is byte for byte what fort::utf8_table makes of the same table in
+FT_BOLD2_STYLE with the alignments and the header color set by
+currency_converter::make_currency_table, without the per-cell objects and the
+generic width passes of libfort.
+
+The display width of every cell has to be known up front: the codes and rates
+are ASCII and the names carry the width worked out by currency_name_table.
+*/
+
+#ifndef CURRENCY_TABLE_RENDERER_H
+#define CURRENCY_TABLE_RENDERER_H
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+// the number rounded half up to the decimal points, as every rate and amount
+// is printed
+inline auto float_to_fixed_string(float const number, int const decimal_points)
+    -> std::string
+{
+    auto const multiplier = (int)std::pow(10, decimal_points);
+
+    auto rounded = float{};
+    rounded      = (int)(number * multiplier + .5);
+    rounded      = rounded / multiplier;
+
+    std::stringstream tmp_ss;
+    tmp_ss << std::fixed << std::setprecision(decimal_points) << rounded;
+
+    return tmp_ss.str();
+}
+
+
+struct currency_table_row {
+    std::string_view code;
+    std::string_view name;
+    int name_width = 0;
+    std::string rate;
+};
+
+
+// the parts of FT_BOLD2_STYLE as libfort draws them
+struct bold2_table_style {
+    // outer borders, header separator, inner separators
+    struct border_line {
+        char const* left;
+        char const* horizontal;
+        char const* middle;
+        char const* right;
+    };
+
+    static constexpr border_line TOP_LINE{"┏", "━", "┯", "┓"};
+    static constexpr border_line HEADER_LINE{"┣", "━", "┿", "┫"};
+    static constexpr border_line ROW_LINE{"┠", "─", "┼", "┨"};
+    static constexpr border_line BOTTOM_LINE{"┗", "━", "┷", "┛"};
+
+    static constexpr char const* OUTER_BORDER = "┃";
+    static constexpr char const* INNER_BORDER = "│";
+
+    // fort::color::light_yellow
+    static constexpr char const* HEADER_COLOR = "\033[93m";
+    static constexpr char const* RESET_COLOR  = "\033[0m";
+
+    // one space on both sides of every cell, as libfort pads by default
+    static int const CELL_PADDING = 1;
+
+    enum class align { left, center, right };
+
+    static auto append_line(std::string& out,
+                            border_line const& line,
+                            std::vector<int> const& column_widths) -> void
+    {
+        out += line.left;
+        for (auto i = 0; i < (int)column_widths.size(); i++) {
+            if (i) {
+                out += line.middle;
+            }
+            for (auto j = 0; j < column_widths[i] + 2 * CELL_PADDING; j++) {
+                out += line.horizontal;
+            }
+        }
+        out += line.right;
+        out += '\n';
+    }
+
+    // libfort puts the odd space of a centered cell on its right
+    static auto append_cell(std::string& out,
+                            std::string_view const text,
+                            int const text_width,
+                            int const column_width,
+                            align const a,
+                            bool const is_header) -> void
+    {
+        auto left_space = 0;
+        if (a == align::center) {
+            left_space = (column_width - text_width) / 2;
+        } else if (a == align::right) {
+            left_space = column_width - text_width;
+        }
+        auto const right_space = column_width - text_width - left_space;
+
+        out.append(CELL_PADDING + left_space, ' ');
+        if (is_header) {
+            out += HEADER_COLOR;
+            out += text;
+            out += RESET_COLOR;
+        } else {
+            out += text;
+        }
+        out.append(right_space + CELL_PADDING, ' ');
+    }
+};
+
+
+struct currency_table_renderer {
+  private:
+    using style = bold2_table_style;
+
+    std::vector<int> column_widths;
+
+  public:
+    // The header cells are centered, the currency codes too, the names and
+    // rates are aligned left.
+    auto render(std::vector<currency_table_row> const& rows,
+                bool const show_names,
+                std::string& out) -> void
+    {
+        std::string_view const currency_header = "Currency";
+        std::string_view const name_header     = "Name";
+        std::string_view const rate_header     = "Rate";
+
+        auto code_width = (int)currency_header.size();
+        auto name_width = (int)name_header.size();
+        auto rate_width = (int)rate_header.size();
+        for (auto const& row : rows) {
+            code_width = std::max(code_width, (int)row.code.size());
+            name_width = std::max(name_width, row.name_width);
+            rate_width = std::max(rate_width, (int)row.rate.size());
+        }
+
+        column_widths.clear();
+        column_widths.push_back(code_width);
+        if (show_names) {
+            column_widths.push_back(name_width);
+        }
+        column_widths.push_back(rate_width);
+
+        auto line_bytes = std::size_t{2 * 3 + 1};
+        for (auto const& width : column_widths) {
+            line_bytes += 3 * (width + 2 * style::CELL_PADDING + 1);
+        }
+        out.clear();
+        out.reserve(line_bytes * (2 * rows.size() + 3));
+
+        auto const append_row = [&](std::string_view const code,
+                                    std::string_view const name,
+                                    int const row_name_width,
+                                    std::string_view const rate,
+                                    bool const is_header) {
+            auto const text_align =
+                is_header ? style::align::center : style::align::left;
+
+            out += style::OUTER_BORDER;
+            style::append_cell(out,
+                               code,
+                               (int)code.size(),
+                               code_width,
+                               style::align::center,
+                               is_header);
+            if (show_names) {
+                out += style::INNER_BORDER;
+                style::append_cell(out,
+                                   name,
+                                   row_name_width,
+                                   name_width,
+                                   text_align,
+                                   is_header);
+            }
+            out += style::INNER_BORDER;
+            style::append_cell(
+                out, rate, (int)rate.size(), rate_width, text_align, is_header);
+            out += style::OUTER_BORDER;
+            out += '\n';
+        };
+
+        style::append_line(out, style::TOP_LINE, column_widths);
+        append_row(currency_header,
+                   name_header,
+                   (int)name_header.size(),
+                   rate_header,
+                   true);
+
+        for (auto i = std::size_t{0}; i < rows.size(); i++) {
+            style::append_line(out,
+                               i ? style::ROW_LINE : style::HEADER_LINE,
+                               column_widths);
+            append_row(rows[i].code,
+                       rows[i].name,
+                       rows[i].name_width,
+                       rows[i].rate,
+                       false);
+        }
+
+        style::append_line(out, style::BOTTOM_LINE, column_widths);
+    }
+};
+
+#endif
@@ -0,0 +1,149 @@
+/*
+console NBP currency converter
+
+MIT License
+
+Copyright (c) 2021 Kajetan Welc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+Timings of the recent fetches, kept for the "stats" command.
+*/
+
+#ifndef FETCH_STATS_H
+#define FETCH_STATS_H
+
+#include <http_client.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+int const FETCH_STATS_CAPACITY = 256;
+
+
+struct fetch_record {
+    std::string source;
+
+    http_timings http;
+    double parse_ms = 0;
+    double apply_ms = 0;
+
+    auto total_ms() const -> double
+    {
+        return http.total_ms + parse_ms + apply_ms;
+    }
+};
+
+
+inline auto
+milliseconds_since(std::chrono::steady_clock::time_point const& start)
+    -> double
+{
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+
+// Fixed-size ring of the latest records; the oldest one is overwritten once
+// the ring is full.
+struct fetch_stats {
+  private:
+    std::array<fetch_record, FETCH_STATS_CAPACITY> records;
+    int next_index = 0;
+    int size       = 0;
+
+    mutable std::mutex mtx;
+
+  public:
+    auto push(fetch_record record) -> void
+    {
+        std::unique_lock<std::mutex> lck{mtx};
+
+        records[next_index] = std::move(record);
+        next_index          = (next_index + 1) % FETCH_STATS_CAPACITY;
+        size                = std::min(size + 1, FETCH_STATS_CAPACITY);
+    }
+
+    // records of the source from the oldest to the latest
+    auto of_source(std::string const& source) const
+        -> std::vector<fetch_record>
+    {
+        std::unique_lock<std::mutex> lck{mtx};
+
+        std::vector<fetch_record> result;
+        auto index = (next_index - size + FETCH_STATS_CAPACITY)
+                     % FETCH_STATS_CAPACITY;
+        for (auto i = 0; i < size; i++) {
+            if (records[index].source == source) {
+                result.push_back(records[index]);
+            }
+            index = (index + 1) % FETCH_STATS_CAPACITY;
+        }
+
+        return result;
+    }
+
+    auto sources() const -> std::vector<std::string>
+    {
+        std::unique_lock<std::mutex> lck{mtx};
+
+        std::vector<std::string> result;
+        for (auto i = 0; i < size; i++) {
+            if (std::find(result.begin(), result.end(), records[i].source)
+                == result.end()) {
+                result.push_back(records[i].source);
+            }
+        }
+        std::sort(result.begin(), result.end());
+
+        return result;
+    }
+
+    // nearest-rank percentile of one stage of the records
+    static auto percentile(std::vector<fetch_record> const& of,
+                           std::function<double(fetch_record const&)> stage,
+                           double const& p) -> double
+    {
+        if (of.empty()) {
+            return 0;
+        }
+
+        std::vector<double> values;
+        for (auto const& each : of) {
+            values.push_back(stage(each));
+        }
+
+        auto const rank = (std::size_t)std::max(
+            0.0, std::ceil(p / 100 * values.size()) - 1);
+        std::nth_element(values.begin(), values.begin() + rank, values.end());
+
+        return values[rank];
+    }
+};
+
+#endif
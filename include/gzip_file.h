@@ -0,0 +1,157 @@
+/*
+console NBP currency converter
+
+MIT License
+
+Copyright (c) 2021 Kajetan Welc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+/*
+gzip compression through zlib. Files are read chunk by chunk through a
+streambuf, so a parser can work on a compressed file without inflating it
+whole into memory. Files that are not compressed are read as they are.
+*/
+
+#ifndef GZIP_FILE_H
+#define GZIP_FILE_H
+
+#include <zlib.h>  // https://zlib.net/
+
+#include <array>
+#include <cstdio>
+#include <filesystem>
+#include <streambuf>
+#include <string>
+
+
+int const GZIP_DEFAULT_LEVEL = 6;
+
+
+struct gzip_file_buffer : std::streambuf {
+  private:
+    static int const CHUNK_SIZE = 64 * 1024;
+
+    gzFile file = nullptr;
+    std::array<char, CHUNK_SIZE> chunk;
+
+  protected:
+    auto underflow() -> int_type override
+    {
+        if (!file) {
+            return traits_type::eof();
+        }
+
+        auto const size = gzread(file, chunk.data(), CHUNK_SIZE);
+        if (size <= 0) {
+            return traits_type::eof();
+        }
+
+        setg(chunk.data(), chunk.data(), chunk.data() + size);
+
+        return traits_type::to_int_type(*gptr());
+    }
+
+  public:
+    explicit gzip_file_buffer(std::string const& file_path)
+        : file{gzopen(file_path.c_str(), "rb")}
+    {
+        if (file) {
+            gzbuffer(file, CHUNK_SIZE);
+        }
+    }
+
+    gzip_file_buffer(gzip_file_buffer const&) = delete;
+    auto operator=(gzip_file_buffer const&) -> gzip_file_buffer& = delete;
+
+    ~gzip_file_buffer() override
+    {
+        if (file) {
+            gzclose(file);
+        }
+    }
+
+    auto is_open() const -> bool
+    {
+        return file != nullptr;
+    }
+};
+
+
+// Writes a temporary file next to the target and renames it, so a reader
+// never sees a half written file.
+inline auto write_gzip_file(std::string const& file_path,
+                            std::string const& data,
+                            int const level = GZIP_DEFAULT_LEVEL) -> bool
+{
+    auto const tmp_path = file_path + ".tmp";
+
+    auto const mode = "wb" + std::to_string(level);
+    auto file       = gzopen(tmp_path.c_str(), mode.c_str());
+    if (!file) {
+        return false;
+    }
+
+    auto written = bool{data.empty()
+                        || gzwrite(file, data.data(), (unsigned)data.size())
+                               == (int)data.size()};
+    written = gzclose(file) == Z_OK && written;
+
+    auto ec = std::error_code{};
+    if (written) {
+        std::filesystem::rename(tmp_path, file_path, ec);
+    }
+    if (!written || ec) {
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+
+// in-memory gzip stream of the data, as sent with Content-Encoding: gzip
+inline auto gzip_compress(std::string const& data,
+                          int const level = GZIP_DEFAULT_LEVEL) -> std::string
+{
+    auto stream = z_stream{};
+
+    // 16 added to the window bits selects the gzip wrapper
+    if (deflateInit2(
+            &stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY)
+        != Z_OK) {
+        return "";
+    }
+
+    auto result = std::string(deflateBound(&stream, data.size()), '\0');
+
+    stream.next_in   = (Bytef*)data.data();
+    stream.avail_in  = (uInt)data.size();
+    stream.next_out  = (Bytef*)result.data();
+    stream.avail_out = (uInt)result.size();
+
+    auto const code = deflate(&stream, Z_FINISH);
+    result.resize(stream.total_out);
+    deflateEnd(&stream);
+
+    return code == Z_STREAM_END ? result : "";
+}
+
+#endif
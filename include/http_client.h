@@ -0,0 +1,328 @@
+/*
+console NBP currency converter
+
+MIT License
+
+Copyright (c) 2021 Kajetan Welc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+GET requests made directly through libcurl. cpr does not expose the curl handle
+of a finished request, so the per-phase timings of the fetches are only
+available this way. Large bodies can also be streamed to a parser while they
+are downloaded.
+*/
+
+#ifndef HTTP_CLIENT_H
+#define HTTP_CLIENT_H
+
+#include <curl/curl.h>  // https://curl.se/libcurl/
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <istream>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+
+
+// durations of the consecutive phases of a request in milliseconds
+struct http_timings {
+    double dns_ms      = 0;
+    double connect_ms  = 0;
+    double tls_ms      = 0;
+    double wait_ms     = 0;
+    double transfer_ms = 0;
+    double total_ms    = 0;
+};
+
+
+struct http_response {
+    long status_code = 0;
+    std::string text;
+
+    // transport error, empty if the server answered
+    std::string error;
+
+    http_timings timings;
+};
+
+
+inline auto http_write_to_string(char* data,
+                                 std::size_t size,
+                                 std::size_t count,
+                                 void* str) -> std::size_t
+{
+    static_cast<std::string*>(str)->append(data, size * count);
+    return size * count;
+}
+
+
+// Response body handed from the curl write callback to a reader thread through
+// a fixed ring of chunks, so its memory does not grow with the body size. The
+// writer blocks while every chunk is still waiting to be read.
+struct http_body_stream : std::streambuf {
+  private:
+    static int const CHUNK_SIZE   = 16 * 1024;
+    static int const CHUNKS_COUNT = 4;
+
+    std::array<std::array<char, CHUNK_SIZE>, CHUNKS_COUNT> chunks;
+    std::array<std::size_t, CHUNKS_COUNT> chunk_sizes{};
+
+    // chunks are filled and read in order, so two counters are enough
+    long long filled_count   = 0;
+    long long released_count = 0;
+    bool is_reading          = false;
+    bool is_finished         = false;
+    bool is_reader_done      = false;
+
+    std::mutex mtx;
+    std::condition_variable cv;
+
+  protected:
+    auto underflow() -> int_type override
+    {
+        std::unique_lock<std::mutex> lck{mtx};
+
+        if (is_reading) {
+            released_count++;
+            is_reading = false;
+            cv.notify_all();
+        }
+
+        cv.wait(lck,
+                [&] { return filled_count > released_count || is_finished; });
+        if (filled_count == released_count) {
+            return traits_type::eof();
+        }
+
+        auto const index = released_count % CHUNKS_COUNT;
+        auto* const data = chunks[index].data();
+        setg(data, data, data + chunk_sizes[index]);
+        is_reading = true;
+
+        return traits_type::to_int_type(*gptr());
+    }
+
+  public:
+    auto write(char const* data, std::size_t size) -> void
+    {
+        while (size) {
+            long long index = 0;
+            {
+                std::unique_lock<std::mutex> lck{mtx};
+                cv.wait(lck, [&] {
+                    return filled_count - released_count < CHUNKS_COUNT
+                           || is_reader_done;
+                });
+                if (is_reader_done) {
+                    return;
+                }
+                index = filled_count % CHUNKS_COUNT;
+            }
+
+            // the reader does not touch a chunk until it is counted as filled
+            auto const chunk_size = std::min(size, (std::size_t)CHUNK_SIZE);
+            std::copy(data, data + chunk_size, chunks[index].data());
+            chunk_sizes[index] = chunk_size;
+
+            data += chunk_size;
+            size -= chunk_size;
+
+            std::unique_lock<std::mutex> lck{mtx};
+            filled_count++;
+            cv.notify_all();
+        }
+    }
+
+    auto finish() -> void
+    {
+        std::unique_lock<std::mutex> lck{mtx};
+        is_finished = true;
+        cv.notify_all();
+    }
+
+    // the rest of the body is dropped once the reader stops reading
+    auto reader_done() -> void
+    {
+        std::unique_lock<std::mutex> lck{mtx};
+        is_reader_done = true;
+        cv.notify_all();
+    }
+};
+
+
+inline auto http_write_to_stream(char* data,
+                                 std::size_t size,
+                                 std::size_t count,
+                                 void* stream) -> std::size_t
+{
+    static_cast<http_body_stream*>(stream)->write(data, size * count);
+    return size * count;
+}
+
+
+inline auto http_check_cancelled(void* cancelled,
+                                 curl_off_t,
+                                 curl_off_t,
+                                 curl_off_t,
+                                 curl_off_t) -> int
+{
+    return static_cast<std::atomic<bool> const*>(cancelled)->load() ? 1 : 0;
+}
+
+
+inline auto http_read_timings(CURL* curl) -> http_timings
+{
+    // libcurl reports the moment each phase ended, counted from the start
+    curl_off_t name_lookup    = 0;
+    curl_off_t connect        = 0;
+    curl_off_t app_connect    = 0;
+    curl_off_t start_transfer = 0;
+    curl_off_t total          = 0;
+
+    curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &name_lookup);
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &app_connect);
+    curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &start_transfer);
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total);
+
+    auto const connected = app_connect ? app_connect : connect;
+
+    auto timings        = http_timings{};
+    timings.dns_ms      = name_lookup / 1000.0;
+    timings.connect_ms  = (connect - name_lookup) / 1000.0;
+    timings.tls_ms      = app_connect ? (app_connect - connect) / 1000.0 : 0;
+    timings.wait_ms     = (start_transfer - connected) / 1000.0;
+    timings.transfer_ms = (total - start_transfer) / 1000.0;
+    timings.total_ms    = total / 1000.0;
+
+    return timings;
+}
+
+
+// Prepares a GET request whose body goes to the given write callback.
+inline auto http_make_request(std::string const& url,
+                              std::atomic<bool> const& cancelled,
+                              long const timeout_ms,
+                              curl_write_callback write,
+                              void* write_data) -> CURL*
+{
+    static std::once_flag curl_global_init_flag;
+    std::call_once(curl_global_init_flag,
+                   [] { curl_global_init(CURL_GLOBAL_DEFAULT); });
+
+    auto* const curl = curl_easy_init();
+    if (!curl) {
+        return nullptr;
+    }
+
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, timeout_ms);
+
+    // an empty string offers every encoding libcurl was built to decode
+    curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, write_data);
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, http_check_cancelled);
+    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, &cancelled);
+
+    return curl;
+}
+
+
+inline auto http_perform(CURL* curl, http_response& response) -> void
+{
+    auto const code = curl_easy_perform(curl);
+    if (code == CURLE_OK) {
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response.status_code);
+    } else {
+        response.error = curl_easy_strerror(code);
+    }
+
+    response.timings = http_read_timings(curl);
+
+    curl_easy_cleanup(curl);
+}
+
+
+inline auto http_get(std::string const& url,
+                     std::atomic<bool> const& cancelled,
+                     long const timeout_ms = 10000) -> http_response
+{
+    auto response = http_response{};
+
+    auto* const curl = http_make_request(
+        url, cancelled, timeout_ms, http_write_to_string, &response.text);
+    if (!curl) {
+        response.error = "curl_easy_init failed";
+        return response;
+    }
+
+    http_perform(curl, response);
+
+    return response;
+}
+
+
+// Like http_get, but instead of collecting the body into response.text it
+// hands it to read_body, which runs on its own thread while the transfer is
+// still going on. read_body may stop reading early.
+inline auto
+http_get_streamed(std::string const& url,
+                  std::atomic<bool> const& cancelled,
+                  std::function<void(std::istream&)> const& read_body,
+                  long const timeout_ms = 10000) -> http_response
+{
+    auto response = http_response{};
+    auto stream   = http_body_stream{};
+
+    auto* const curl = http_make_request(
+        url, cancelled, timeout_ms, http_write_to_stream, &stream);
+    if (!curl) {
+        response.error = "curl_easy_init failed";
+        return response;
+    }
+
+    auto reader = std::thread{[&] {
+        std::istream body{&stream};
+        try {
+            read_body(body);
+        } catch (...) {
+        }
+        stream.reader_done();
+    }};
+
+    http_perform(curl, response);
+
+    stream.finish();
+    reader.join();
+
+    return response;
+}
+
+#endif
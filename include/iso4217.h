@@ -0,0 +1,195 @@
+/*
+console NBP currency converter
+
+MIT License
+
+Copyright (c) 2021 Kajetan Welc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+ISO 4217 currency registry, worked out at compile time. The id of a currency is
+its index in ISO4217_CURRENCIES, which is sorted by code, and every possible
+three letter code maps to its id (or -1) through one dense array indexed by
+the letters, so a lookup is a few arithmetic operations and one load.
+
+Besides the active codes, the list keeps the withdrawn ones that appear in the
+NBP tables A and B since 2002, the first year the NBP API serves, e.g. TRL,
+CSD or ZWD. A code outside of the list still converts, only it is looked up by
+a binary search instead of its id.
+*/
+
+#ifndef ISO4217_H
+#define ISO4217_H
+
+#include <cstdint>
+#include <string_view>
+
+
+struct iso4217_currency {
+    char code[4];
+    std::int16_t numeric;
+
+    // digits after the decimal point of an amount, -1 where ISO 4217 has
+    // none (precious metals, SDR, testing codes)
+    std::int8_t minor_units;
+};
+
+
+inline constexpr iso4217_currency ISO4217_CURRENCIES[] = {
+    {"AED", 784, 2},  {"AFA", 4, 2},    {"AFN", 971, 2},  {"ALL", 8, 2},
+    {"AMD", 51, 2},   {"ANG", 532, 2},  {"AOA", 973, 2},  {"ARS", 32, 2},
+    {"AUD", 36, 2},   {"AWG", 533, 2},  {"AZM", 31, 2},   {"AZN", 944, 2},
+    {"BAM", 977, 2},  {"BBD", 52, 2},   {"BDT", 50, 2},   {"BGN", 975, 2},
+    {"BHD", 48, 3},   {"BIF", 108, 0},  {"BMD", 60, 2},   {"BND", 96, 2},
+    {"BOB", 68, 2},   {"BOV", 984, 2},  {"BRL", 986, 2},  {"BSD", 44, 2},
+    {"BTN", 64, 2},   {"BWP", 72, 2},   {"BYN", 933, 2},  {"BYR", 974, 0},
+    {"BZD", 84, 2},   {"CAD", 124, 2},  {"CDF", 976, 2},  {"CHE", 947, 2},
+    {"CHF", 756, 2},  {"CHW", 948, 2},  {"CLF", 990, 4},  {"CLP", 152, 0},
+    {"CNY", 156, 2},  {"COP", 170, 2},  {"COU", 970, 2},  {"CRC", 188, 2},
+    {"CSD", 891, 2},  {"CUC", 931, 2},  {"CUP", 192, 2},  {"CVE", 132, 2},
+    {"CYP", 196, 2},  {"CZK", 203, 2},  {"DJF", 262, 0},  {"DKK", 208, 2},
+    {"DOP", 214, 2},  {"DZD", 12, 2},   {"EEK", 233, 2},  {"EGP", 818, 2},
+    {"ERN", 232, 2},  {"ETB", 230, 2},  {"EUR", 978, 2},  {"FJD", 242, 2},
+    {"FKP", 238, 2},  {"GBP", 826, 2},  {"GEL", 981, 2},  {"GHC", 288, 2},
+    {"GHS", 936, 2},  {"GIP", 292, 2},  {"GMD", 270, 2},  {"GNF", 324, 0},
+    {"GTQ", 320, 2},  {"GYD", 328, 2},  {"HKD", 344, 2},  {"HNL", 340, 2},
+    {"HRK", 191, 2},  {"HTG", 332, 2},  {"HUF", 348, 2},  {"IDR", 360, 2},
+    {"ILS", 376, 2},  {"INR", 356, 2},  {"IQD", 368, 3},  {"IRR", 364, 2},
+    {"ISK", 352, 0},  {"JMD", 388, 2},  {"JOD", 400, 3},  {"JPY", 392, 0},
+    {"KES", 404, 2},  {"KGS", 417, 2},  {"KHR", 116, 2},  {"KMF", 174, 0},
+    {"KPW", 408, 2},  {"KRW", 410, 0},  {"KWD", 414, 3},  {"KYD", 136, 2},
+    {"KZT", 398, 2},  {"LAK", 418, 2},  {"LBP", 422, 2},  {"LKR", 144, 2},
+    {"LRD", 430, 2},  {"LSL", 426, 2},  {"LTL", 440, 2},  {"LVL", 428, 2},
+    {"LYD", 434, 3},  {"MAD", 504, 2},  {"MDL", 498, 2},  {"MGA", 969, 2},
+    {"MGF", 450, 0},  {"MKD", 807, 2},  {"MMK", 104, 2},  {"MNT", 496, 2},
+    {"MOP", 446, 2},  {"MRO", 478, 2},  {"MRU", 929, 2},  {"MTL", 470, 2},
+    {"MUR", 480, 2},  {"MVR", 462, 2},  {"MWK", 454, 2},  {"MXN", 484, 2},
+    {"MXV", 979, 2},  {"MYR", 458, 2},  {"MZM", 508, 2},  {"MZN", 943, 2},
+    {"NAD", 516, 2},  {"NGN", 566, 2},  {"NIO", 558, 2},  {"NOK", 578, 2},
+    {"NPR", 524, 2},  {"NZD", 554, 2},  {"OMR", 512, 3},  {"PAB", 590, 2},
+    {"PEN", 604, 2},  {"PGK", 598, 2},  {"PHP", 608, 2},  {"PKR", 586, 2},
+    {"PLN", 985, 2},  {"PYG", 600, 0},  {"QAR", 634, 2},  {"ROL", 642, 2},
+    {"RON", 946, 2},  {"RSD", 941, 2},  {"RUB", 643, 2},  {"RWF", 646, 0},
+    {"SAR", 682, 2},  {"SBD", 90, 2},   {"SCR", 690, 2},  {"SDD", 736, 2},
+    {"SDG", 938, 2},  {"SEK", 752, 2},  {"SGD", 702, 2},  {"SHP", 654, 2},
+    {"SIT", 705, 2},  {"SKK", 703, 2},  {"SLE", 925, 2},  {"SLL", 694, 2},
+    {"SOS", 706, 2},  {"SRD", 968, 2},  {"SRG", 740, 2},  {"SSP", 728, 2},
+    {"STD", 678, 2},  {"STN", 930, 2},  {"SVC", 222, 2},  {"SYP", 760, 2},
+    {"SZL", 748, 2},  {"THB", 764, 2},  {"TJS", 972, 2},  {"TMM", 795, 2},
+    {"TMT", 934, 2},  {"TND", 788, 3},  {"TOP", 776, 2},  {"TRL", 792, 0},
+    {"TRY", 949, 2},  {"TTD", 780, 2},  {"TWD", 901, 2},  {"TZS", 834, 2},
+    {"UAH", 980, 2},  {"UGX", 800, 0},  {"USD", 840, 2},  {"USN", 997, 2},
+    {"UYI", 940, 0},  {"UYU", 858, 2},  {"UYW", 927, 4},  {"UZS", 860, 2},
+    {"VEB", 862, 2},  {"VED", 926, 2},  {"VEF", 937, 2},  {"VES", 928, 2},
+    {"VND", 704, 0},  {"VUV", 548, 0},  {"WST", 882, 2},  {"XAF", 950, 0},
+    {"XAG", 961, -1}, {"XAU", 959, -1}, {"XBA", 955, -1}, {"XBB", 956, -1},
+    {"XBC", 957, -1}, {"XBD", 958, -1}, {"XCD", 951, 2},  {"XDR", 960, -1},
+    {"XOF", 952, 0},  {"XPD", 964, -1}, {"XPF", 953, 0},  {"XPT", 962, -1},
+    {"XSU", 994, -1}, {"XTS", 963, -1}, {"XUA", 965, -1}, {"XXX", 999, -1},
+    {"YER", 886, 2},  {"YUM", 891, 2},  {"ZAR", 710, 2},  {"ZMK", 894, 2},
+    {"ZMW", 967, 2},  {"ZWD", 716, 2},  {"ZWG", 924, 2},  {"ZWL", 932, 2}};
+
+inline constexpr int ISO4217_CURRENCIES_COUNT =
+    sizeof(ISO4217_CURRENCIES) / sizeof(ISO4217_CURRENCIES[0]);
+
+// every string of three capital letters
+inline constexpr int ISO4217_CODE_SPACE = 26 * 26 * 26;
+
+
+// -1 for anything but three capital letters
+constexpr auto iso4217_code_index(std::string_view const code) -> int
+{
+    if (code.size() != 3) {
+        return -1;
+    }
+
+    auto index = 0;
+    for (auto const c : code) {
+        if (c < 'A' || c > 'Z') {
+            return -1;
+        }
+        index = index * 26 + (c - 'A');
+    }
+
+    return index;
+}
+
+
+struct iso4217_index {
+    std::int16_t ids[ISO4217_CODE_SPACE];
+};
+
+
+constexpr auto make_iso4217_index() -> iso4217_index
+{
+    auto index = iso4217_index{};
+    for (auto& id : index.ids) {
+        id = -1;
+    }
+
+    for (auto id = 0; id < ISO4217_CURRENCIES_COUNT; id++) {
+        auto const& code = ISO4217_CURRENCIES[id].code;
+        index.ids[iso4217_code_index({code, 3})] = (std::int16_t)id;
+    }
+
+    return index;
+}
+
+inline constexpr iso4217_index ISO4217_INDEX = make_iso4217_index();
+
+
+// -1 for a code that is not in the registry
+constexpr auto iso4217_id(std::string_view const code) -> int
+{
+    auto const index = iso4217_code_index(code);
+    return index == -1 ? -1 : ISO4217_INDEX.ids[index];
+}
+
+constexpr auto iso4217_minor_units(int const id) -> int
+{
+    return ISO4217_CURRENCIES[id].minor_units;
+}
+
+constexpr auto iso4217_numeric_code(int const id) -> int
+{
+    return ISO4217_CURRENCIES[id].numeric;
+}
+
+
+constexpr auto is_iso4217_sorted() -> bool
+{
+    for (auto id = 1; id < ISO4217_CURRENCIES_COUNT; id++) {
+        if (iso4217_code_index({ISO4217_CURRENCIES[id - 1].code, 3})
+            >= iso4217_code_index({ISO4217_CURRENCIES[id].code, 3})) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static_assert(is_iso4217_sorted(), "ISO4217_CURRENCIES must be sorted");
+static_assert(iso4217_minor_units(iso4217_id("JPY")) == 0);
+static_assert(iso4217_minor_units(iso4217_id("KWD")) == 3);
+static_assert(iso4217_numeric_code(iso4217_id("PLN")) == 985);
+static_assert(iso4217_id("ABC") == -1 && iso4217_id("pln") == -1);
+static_assert(iso4217_minor_units(iso4217_id("TRL")) == 0);
+
+#endif
@@ -0,0 +1,298 @@
+/*
+console NBP currency converter
+
+MIT License
+
+Copyright (c) 2021 Kajetan Welc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+Streaming parser of the NBP exchange rate tables:
+
+  [{"table": "A", "no": "042/A/NBP/2021", "effectiveDate": "2021-03-03",
+    "rates": [{"currency": "euro", "code": "EUR", "mid": 4.5393}, ...]}, ...]
+
+Tables A and B quote mid rates, table C quotes bid and ask rates instead:
+
+  [{"table": "C", ..., "rates": [{"code": "EUR", "bid": 4.49, "ask": 4.58}]}]
+
+It is built on nlohmann::json::sax_parse, so no DOM is made. The values of a
+rate are copied into buffers that are reused for every rate and handed to a
+sink, which stores them wherever it wants.
+*/
+
+#ifndef NBP_TABLE_PARSER_H
+#define NBP_TABLE_PARSER_H
+
+#include <nlohmann/json.hpp>  // https://github.com/nlohmann/json
+
+#include <string>
+#include <utility>
+
+
+struct nbp_table_sink {
+    virtual ~nbp_table_sink() = default;
+
+    virtual auto table_begin() -> void
+    {
+    }
+
+    virtual auto table_name(std::string const&) -> void
+    {
+    }
+
+    virtual auto effective_date(std::string const& date) -> void = 0;
+
+    virtual auto rate(std::string const& code,
+                      double const& mid,
+                      std::string const& name) -> void = 0;
+
+    virtual auto bid_ask_rate(std::string const&,
+                              double const&,
+                              double const&,
+                              std::string const&) -> void
+    {
+    }
+
+    virtual auto table_end() -> void
+    {
+    }
+};
+
+
+struct nbp_table_sax : nlohmann::json_sax<nlohmann::json> {
+  private:
+    // the keys the parser cares about, so no key is stored as a string
+    enum class key_name {
+        other,
+        table,
+        effective_date,
+        rates,
+        code,
+        mid,
+        bid,
+        ask,
+        currency
+    };
+
+    // nesting: tables array, table, rates array, rate
+    int const TABLE_DEPTH = 2;
+    int const RATES_DEPTH = 3;
+    int const RATE_DEPTH  = 4;
+
+    nbp_table_sink& sink;
+
+    int depth            = 0;
+    bool in_rates        = false;
+    key_name current_key = key_name::other;
+
+    std::string code;
+    std::string name;
+    double mid    = 0;
+    double bid    = 0;
+    double ask    = 0;
+    bool has_code = false;
+    bool has_mid  = false;
+    bool has_bid  = false;
+    bool has_ask  = false;
+
+    auto number(double const& value) -> bool
+    {
+        if (depth != RATE_DEPTH) {
+            return true;
+        }
+
+        if (current_key == key_name::mid) {
+            mid     = value;
+            has_mid = true;
+        } else if (current_key == key_name::bid) {
+            bid     = value;
+            has_bid = true;
+        } else if (current_key == key_name::ask) {
+            ask     = value;
+            has_ask = true;
+        }
+
+        return true;
+    }
+
+  public:
+    int rates_count = 0;
+
+    explicit nbp_table_sax(nbp_table_sink& s) : sink{s}
+    {
+    }
+
+    auto null() -> bool override
+    {
+        return true;
+    }
+
+    auto boolean(bool) -> bool override
+    {
+        return true;
+    }
+
+    auto number_integer(number_integer_t value) -> bool override
+    {
+        return number((double)value);
+    }
+
+    auto number_unsigned(number_unsigned_t value) -> bool override
+    {
+        return number((double)value);
+    }
+
+    auto number_float(number_float_t value, string_t const&) -> bool override
+    {
+        return number(value);
+    }
+
+    auto string(string_t& value) -> bool override
+    {
+        if (depth == TABLE_DEPTH && current_key == key_name::table) {
+            sink.table_name(value);
+        } else if (depth == TABLE_DEPTH
+                   && current_key == key_name::effective_date) {
+            sink.effective_date(value);
+        } else if (depth == RATE_DEPTH && current_key == key_name::code) {
+            code.assign(value);
+            has_code = true;
+        } else if (depth == RATE_DEPTH && current_key == key_name::currency) {
+            name.assign(value);
+        }
+
+        return true;
+    }
+
+    auto binary(binary_t&) -> bool override
+    {
+        return true;
+    }
+
+    auto start_object(std::size_t) -> bool override
+    {
+        depth++;
+
+        if (depth == TABLE_DEPTH) {
+            sink.table_begin();
+        } else if (depth == RATE_DEPTH && in_rates) {
+            name.clear();
+            has_code = false;
+            has_mid  = false;
+            has_bid  = false;
+            has_ask  = false;
+        }
+
+        current_key = key_name::other;
+        return true;
+    }
+
+    auto key(string_t& value) -> bool override
+    {
+        current_key = key_name::other;
+
+        if (depth == TABLE_DEPTH) {
+            if (value == "table") {
+                current_key = key_name::table;
+            } else if (value == "effectiveDate") {
+                current_key = key_name::effective_date;
+            } else if (value == "rates") {
+                current_key = key_name::rates;
+            }
+        } else if (depth == RATE_DEPTH) {
+            if (value == "code") {
+                current_key = key_name::code;
+            } else if (value == "mid") {
+                current_key = key_name::mid;
+            } else if (value == "bid") {
+                current_key = key_name::bid;
+            } else if (value == "ask") {
+                current_key = key_name::ask;
+            } else if (value == "currency") {
+                current_key = key_name::currency;
+            }
+        }
+
+        return true;
+    }
+
+    auto end_object() -> bool override
+    {
+        if (depth == RATE_DEPTH && in_rates && has_code && has_mid) {
+            sink.rate(code, mid, name);
+            rates_count++;
+        } else if (depth == RATE_DEPTH && in_rates && has_code && has_bid
+                   && has_ask) {
+            sink.bid_ask_rate(code, bid, ask, name);
+            rates_count++;
+        } else if (depth == TABLE_DEPTH) {
+            sink.table_end();
+        }
+
+        depth--;
+        return true;
+    }
+
+    auto start_array(std::size_t) -> bool override
+    {
+        depth++;
+
+        if (depth == RATES_DEPTH && current_key == key_name::rates) {
+            in_rates = true;
+        }
+
+        return true;
+    }
+
+    auto end_array() -> bool override
+    {
+        if (depth == RATES_DEPTH) {
+            in_rates = false;
+        }
+
+        depth--;
+        return true;
+    }
+
+    auto parse_error(std::size_t,
+                     std::string const&,
+                     nlohmann::detail::exception const&) -> bool override
+    {
+        return false;
+    }
+};
+
+
+// Parses a string or reads a stream to its end. Returns false if the input is
+// not valid JSON or holds no rates.
+template<typename Input>
+auto parse_nbp_tables(Input&& input, nbp_table_sink& sink) -> bool
+{
+    auto handler = nbp_table_sax{sink};
+
+    if (!nlohmann::json::sax_parse(std::forward<Input>(input), &handler)) {
+        return false;
+    }
+
+    return handler.rates_count > 0;
+}
+
+#endif
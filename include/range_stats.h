@@ -0,0 +1,168 @@
+/*
+console NBP currency converter
+
+MIT License
+
+Copyright (c) 2021 Kajetan Welc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+/*
+Statistics of the rates of a currency over a range of days, reduced from the
+chunks handed out by rate_history::for_each_cross_rate_chunk.
+*/
+
+#ifndef RANGE_STATS_H
+#define RANGE_STATS_H
+
+#include <rate_history.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+
+
+struct range_stats {
+    int count = 0;
+
+    double first  = 0;
+    double last   = 0;
+    double min    = 0;
+    double max    = 0;
+    double mean   = 0;
+    double stddev = 0;
+
+    int first_day_index = -1;
+    int last_day_index  = -1;
+};
+
+
+// Keeps LANES independent partial results, so the loop over a chunk has no
+// dependency between neighbouring rates and the compiler can keep the lanes
+// in vector registers. The sums are taken relative to the first rate, which
+// keeps the variance exact enough for rates that barely move.
+struct range_stats_accumulator {
+  private:
+    static int const LANES = 4;
+
+    double min[LANES];
+    double max[LANES];
+    double sum[LANES]    = {};
+    double sum_sq[LANES] = {};
+
+    double shift = 0;
+    range_stats stats;
+
+  public:
+    range_stats_accumulator()
+    {
+        std::fill(min, min + LANES, std::numeric_limits<double>::infinity());
+        std::fill(max, max + LANES, -std::numeric_limits<double>::infinity());
+    }
+
+    auto add(double const* rates, int const count, int const day_index)
+        -> void
+    {
+        if (!count) {
+            return;
+        }
+
+        if (!stats.count) {
+            shift                 = rates[0];
+            stats.first           = rates[0];
+            stats.first_day_index = day_index;
+        }
+        stats.last           = rates[count - 1];
+        stats.last_day_index = day_index + count - 1;
+        stats.count += count;
+
+        auto i = 0;
+        for (; i + LANES <= count; i += LANES) {
+            for (auto lane = 0; lane < LANES; lane++) {
+                auto const rate = rates[i + lane];
+                auto const diff = rate - shift;
+
+                min[lane] = std::min(min[lane], rate);
+                max[lane] = std::max(max[lane], rate);
+                sum[lane] += diff;
+                sum_sq[lane] += diff * diff;
+            }
+        }
+        for (; i < count; i++) {
+            auto const diff = rates[i] - shift;
+
+            min[0] = std::min(min[0], rates[i]);
+            max[0] = std::max(max[0], rates[i]);
+            sum[0] += diff;
+            sum_sq[0] += diff * diff;
+        }
+    }
+
+    auto result() const -> range_stats
+    {
+        auto result = stats;
+        if (!result.count) {
+            return result;
+        }
+
+        auto total    = 0.0;
+        auto total_sq = 0.0;
+        result.min    = min[0];
+        result.max    = max[0];
+        for (auto lane = 0; lane < LANES; lane++) {
+            result.min = std::min(result.min, min[lane]);
+            result.max = std::max(result.max, max[lane]);
+            total += sum[lane];
+            total_sq += sum_sq[lane];
+        }
+
+        auto const mean_diff = total / result.count;
+        result.mean          = shift + mean_diff;
+        result.stddev        = std::sqrt(
+            std::max(0.0, total_sq / result.count - mean_diff * mean_diff));
+
+        return result;
+    }
+};
+
+
+// Statistics of the currency in the base currency over the days [from, to)
+// of the history.
+inline auto compute_range_stats(rate_history const& history,
+                                std::string const& code,
+                                std::string const& base,
+                                int const from,
+                                int const to) -> range_stats
+{
+    auto accumulator = range_stats_accumulator{};
+    history.for_each_cross_rate_chunk(
+        code,
+        base,
+        from,
+        to,
+        [&](double const* rates, int const count, int const day_index) {
+            accumulator.add(rates, count, day_index);
+        });
+
+    return accumulator.result();
+}
+
+#endif
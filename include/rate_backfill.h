@@ -0,0 +1,283 @@
+/*
+console NBP currency converter
+
+MIT License
+
+Copyright (c) 2021 Kajetan Welc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+Backfill of the rates history from the NBP date range queries, which answer at
+most NBP_RANGE_MAX_DAYS days each. The range is cut into chunks that a few
+threads download at once, while the starts of all their requests are spaced by
+one global rate cap. Every chunk is parsed while it downloads and handed over
+in the order of the chunks as soon as all the earlier ones are in, so the
+handed over days never leave a gap, even when a later chunk fails.
+*/
+
+#ifndef RATE_BACKFILL_H
+#define RATE_BACKFILL_H
+
+#include <fetch_stats.h>
+#include <http_client.h>
+#include <nbp_table_parser.h>
+#include <rate_history.h>
+#include <rate_providers.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <istream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+int const NBP_RANGE_MAX_DAYS          = 93;
+int const BACKFILL_ATTEMPTS_COUNT     = 3;
+int const BACKFILL_TIMEOUT_MS         = 30000;
+int const BACKFILL_RETRY_DELAY_MS     = 1000;
+char const BACKFILL_RECORD_SOURCE[]   = "NBP backfill";
+
+
+struct backfill_chunk {
+    int from_day = 0;
+    int to_day   = 0;
+};
+
+
+// consecutive chunks of at most max_days days covering [from_day, to_day]
+inline auto make_backfill_chunks(int const from_day,
+                                 int const to_day,
+                                 int const max_days = NBP_RANGE_MAX_DAYS)
+    -> std::vector<backfill_chunk>
+{
+    std::vector<backfill_chunk> chunks;
+    for (auto day = from_day; day <= to_day; day += max_days) {
+        chunks.push_back({day, std::min(day + max_days - 1, to_day)});
+    }
+
+    return chunks;
+}
+
+
+// Spaces the starts of the requests of every thread at least 1 / rate apart.
+// A rate of 0 lets them all through.
+struct request_rate_limiter {
+  private:
+    std::chrono::steady_clock::duration const interval;
+    std::chrono::steady_clock::time_point next_start;
+    std::mutex mtx;
+
+  public:
+    explicit request_rate_limiter(double const requests_per_second)
+        : interval{requests_per_second > 0
+                       ? std::chrono::duration_cast<
+                           std::chrono::steady_clock::duration>(
+                           std::chrono::duration<double>{
+                               1 / requests_per_second})
+                       : std::chrono::steady_clock::duration::zero()}
+    {
+    }
+
+    auto wait() -> void
+    {
+        auto start = std::chrono::steady_clock::now();
+        {
+            std::unique_lock<std::mutex> lck{mtx};
+            start      = std::max(start, next_start);
+            next_start = start + interval;
+        }
+
+        std::this_thread::sleep_until(start);
+    }
+};
+
+
+// every table of a response, in the order of the response
+struct rate_table_list_sink : nbp_table_sink {
+    std::vector<rate_table> tables;
+
+    auto table_begin() -> void override
+    {
+        tables.emplace_back();
+    }
+
+    auto effective_date(std::string const& date) -> void override
+    {
+        tables.back().publication_date = date;
+    }
+
+    auto rate(std::string const& code,
+              double const& mid,
+              std::string const&) -> void override
+    {
+        tables.back().rates.push_back({code, (float)mid, 'A', {}});
+    }
+
+    auto table_end() -> void override
+    {
+        auto& table = tables.back();
+        for (auto& each : table.rates) {
+            each.effective_date = table.publication_date;
+        }
+        sort_unique_by_code(table.rates, &currency_rate::code);
+    }
+};
+
+
+struct backfill_chunk_result {
+    std::vector<rate_table> tables;
+    std::string error;
+
+    int attempts = 0;
+    fetch_record record;
+};
+
+
+// One date range query. NBP answers 404 for a range without tables, which
+// counts as an empty chunk.
+inline auto fetch_backfill_chunk(std::string const& url,
+                                 std::atomic<bool> const& cancelled)
+    -> backfill_chunk_result
+{
+    auto result = backfill_chunk_result{};
+    auto sink   = rate_table_list_sink{};
+    auto parsed = bool{false};
+
+    auto const response = http_get_streamed(
+        url,
+        cancelled,
+        [&](std::istream& body) { parsed = parse_nbp_tables(body, sink); },
+        BACKFILL_TIMEOUT_MS);
+
+    if (!response.error.empty()
+        || (response.status_code >= 400 && response.status_code != 404)) {
+        result.error = "NBP HTTP request error";
+        if (response.error.empty()) {
+            result.error += " " + std::to_string(response.status_code);
+        }
+        return result;
+    }
+
+    if (response.status_code != 404) {
+        if (!parsed) {
+            result.error = "NBP API parse error";
+            return result;
+        }
+        result.tables = std::move(sink.tables);
+    }
+
+    result.record.source = BACKFILL_RECORD_SOURCE;
+    result.record.http   = response.timings;
+
+    return result;
+}
+
+
+// Downloads url_prefix + "FROM/TO/?format=json" of every chunk with up to jobs
+// threads, retrying failed requests, and hands the tables of each chunk to
+// commit(chunk index, tables) in chunk order, one call at a time. No chunk is
+// started after one has failed for good, so the committed chunks always run
+// from the first one up to the failed one.
+inline auto fetch_backfill_chunks(
+    std::string const& url_prefix,
+    std::vector<backfill_chunk> const& chunks,
+    int const jobs,
+    double const requests_per_second,
+    std::function<void(int, std::vector<rate_table>&)> const& commit)
+    -> std::vector<backfill_chunk_result>
+{
+    auto const chunks_size = (int)chunks.size();
+
+    std::vector<backfill_chunk_result> results(chunks_size);
+    std::vector<bool> finished(chunks_size, false);
+    auto next_commit_index = int{0};
+    std::mutex mtx;
+
+    std::atomic<int> next_chunk_index{0};
+    std::atomic<int> failed_chunk_index{chunks_size};
+    std::atomic<bool> const not_cancelled{false};
+    auto limiter = request_rate_limiter{requests_per_second};
+
+    auto const worker = [&] {
+        while (true) {
+            auto const index = next_chunk_index++;
+            if (index >= chunks_size || index > failed_chunk_index) {
+                return;
+            }
+
+            auto const url = url_prefix
+                             + days_to_date(chunks[index].from_day) + "/"
+                             + days_to_date(chunks[index].to_day)
+                             + "/?format=json";
+
+            auto result = backfill_chunk_result{};
+            for (auto attempt = 1; attempt <= BACKFILL_ATTEMPTS_COUNT;
+                 attempt++) {
+                if (attempt > 1) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds{
+                        BACKFILL_RETRY_DELAY_MS * (attempt - 1)});
+                }
+
+                limiter.wait();
+                result          = fetch_backfill_chunk(url, not_cancelled);
+                result.attempts = attempt;
+                if (result.error.empty()) {
+                    break;
+                }
+            }
+
+            std::unique_lock<std::mutex> lck{mtx};
+
+            if (!result.error.empty()) {
+                auto failed = failed_chunk_index.load();
+                while (index < failed
+                       && !failed_chunk_index.compare_exchange_weak(failed,
+                                                                    index)) {
+                }
+            }
+            results[index]  = std::move(result);
+            finished[index] = true;
+
+            while (next_commit_index < chunks_size
+                   && finished[next_commit_index]
+                   && results[next_commit_index].error.empty()) {
+                commit(next_commit_index, results[next_commit_index].tables);
+                results[next_commit_index].tables.clear();
+                next_commit_index++;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (auto i = 0; i < std::max(1, std::min(jobs, chunks_size)); i++) {
+        threads.push_back(std::thread{worker});
+    }
+    for (auto& each : threads) {
+        each.join();
+    }
+
+    return results;
+}
+
+#endif
@@ -0,0 +1,885 @@
+/*
+console NBP currency converter
+
+MIT License
+
+Copyright (c) 2021 Kajetan Welc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+/*
+Daily exchange rates of every currency, one column per currency. The rates are
+kept as fixed-point integers; each column is cut into blocks of
+RATE_HISTORY_BLOCK_DAYS days holding the first value and the bit-packed
+differences between the following ones:
+
+  block: first value, smallest difference, power of ten dividing all the
+         differences, bit width
+  words: difference / 10^power - smallest difference, bit width bits each
+
+All differences of a block have the same width, so they are unpacked without
+branches by code specialized for that width. The newest block stays unpacked
+until it is full.
+
+A dense index with one entry per calendar day since the first table maps a date
+to the table in force on it, so weekends and holidays resolve to the previous
+publication day in O(1).
+
+The history is saved as gzip compressed text, one line per day:
+
+  nbp_converter_history 8
+  codes AUD CAD ...
+  2021-03-03 291680000 - ...
+
+where 8 is RATE_HISTORY_DECIMALS and "-" marks the days before a currency
+first appeared.
+*/
+
+#ifndef RATE_HISTORY_H
+#define RATE_HISTORY_H
+
+#include <currency_rate.h>
+#include <gzip_file.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+int const RATE_HISTORY_BLOCK_DAYS = 128;
+
+// rates are stored in hundred-millionths of PLN, the finest NBP quotes
+int const RATE_HISTORY_DECIMALS    = 8;
+double const RATE_HISTORY_UNIT     = 1e-8;
+double const RATE_HISTORY_PER_UNIT = 1e8;
+
+// the digits of a rate that survive its trip through a float
+int const RATE_HISTORY_SIGNIFICANT_DIGITS = 7;
+
+char const RATE_HISTORY_FILE_MAGIC[] = "nbp_converter_history";
+
+
+// days since 1970-01-01 of a proleptic Gregorian date
+inline auto days_from_civil(int y, int const m, int const d) -> int
+{
+    y -= m <= 2;
+    auto const era = (y >= 0 ? y : y - 399) / 400;
+    auto const yoe = y - era * 400;
+    auto const doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    auto const doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+    return era * 146097 + doe - 719468;
+}
+
+
+// "YYYY-MM-DD" to days since 1970-01-01, -1 if the date is malformed
+inline auto date_to_days(std::string const& date) -> int
+{
+    auto y = 0;
+    auto m = 0;
+    auto d = 0;
+    if (date.size() != 10
+        || std::sscanf(date.c_str(), "%4d-%2d-%2d", &y, &m, &d) != 3
+        || m < 1 || m > 12 || d < 1 || d > 31) {
+        return -1;
+    }
+
+    return days_from_civil(y, m, d);
+}
+
+
+inline auto days_to_date(int days) -> std::string
+{
+    days += 719468;
+    auto const era = (days >= 0 ? days : days - 146096) / 146097;
+    auto const doe = days - era * 146097;
+    auto const yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    auto const doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    auto const mp  = (5 * doy + 2) / 153;
+    auto const d   = doy - (153 * mp + 2) / 5 + 1;
+    auto const m   = mp + (mp < 10 ? 3 : -9);
+    auto const y   = yoe + era * 400 + (m <= 2);
+
+    char date[32];
+    std::snprintf(date, sizeof(date), "%04d-%02d-%02d", y, m, d);
+
+    return date;
+}
+
+
+struct rate_history_column {
+  private:
+    struct block {
+        std::int64_t base      = 0;
+        std::int64_t min_delta = 0;
+        std::uint32_t offset   = 0;
+        std::uint8_t power     = 0;
+        std::uint8_t bit_width = 0;
+        std::uint16_t count    = 0;
+    };
+
+    static constexpr std::int64_t POWERS_OF_TEN[] = {
+        1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000};
+
+    // widths up to this one are unpacked by code specialized for the width
+    static int const MAX_SPECIALIZED_WIDTH = 32;
+
+    static_assert(RATE_HISTORY_BLOCK_DAYS == 128,
+                  "a block is unpacked as two groups of 64 values");
+
+    std::vector<block> blocks;
+
+    // one word more than the packed values need, so the generic unpacking
+    // loop may always read the word after the current one
+    std::vector<std::uint64_t> words{0};
+
+    std::vector<std::int64_t> open_block;
+
+    // kept apart, so last() does not unpack a packed last block
+    std::int64_t last_value = 0;
+
+    auto pack_open_block() -> void
+    {
+        auto b   = block{};
+        b.base   = open_block[0];
+        b.count  = (std::uint16_t)open_block.size();
+        b.offset = (std::uint32_t)(words.size() - 1);
+
+        // 4 decimal rates stored in hundred-millionths differ by multiples
+        // of 10000
+        for (auto p = RATE_HISTORY_DECIMALS; p > 0; p--) {
+            auto divisible = bool{true};
+            for (auto i = std::size_t{1}; i < open_block.size() && divisible;
+                 i++) {
+                divisible =
+                    (open_block[i] - open_block[i - 1]) % POWERS_OF_TEN[p]
+                    == 0;
+            }
+            if (divisible) {
+                b.power = (std::uint8_t)p;
+                break;
+            }
+        }
+
+        std::vector<std::int64_t> deltas;
+        for (auto i = std::size_t{1}; i < open_block.size(); i++) {
+            deltas.push_back((open_block[i] - open_block[i - 1])
+                             / POWERS_OF_TEN[b.power]);
+        }
+        b.min_delta = *std::min_element(deltas.begin(), deltas.end());
+
+        auto max_packed = std::uint64_t{0};
+        for (auto const& each : deltas) {
+            max_packed =
+                std::max(max_packed, (std::uint64_t)(each - b.min_delta));
+        }
+        while (b.bit_width < 64 && (max_packed >> b.bit_width)) {
+            b.bit_width++;
+        }
+
+        auto const bits_count = deltas.size() * b.bit_width;
+        words.resize(words.size() + (bits_count + 63) / 64);
+
+        for (auto i = std::size_t{0}; i < deltas.size(); i++) {
+            auto const packed = (std::uint64_t)(deltas[i] - b.min_delta);
+            auto const bit    = b.offset * 64 + i * b.bit_width;
+            auto const index  = bit / 64;
+            auto const shift  = bit % 64;
+
+            words[index] |= packed << shift;
+            if (shift + b.bit_width > 64) {
+                words[index + 1] |= packed >> (64 - shift);
+            }
+        }
+
+        blocks.push_back(b);
+        open_block.clear();
+    }
+
+    template<int WIDTH, int I>
+    static auto unpack_value(std::uint64_t const* data) -> std::uint64_t
+    {
+        auto constexpr mask  = (std::uint64_t{1} << WIDTH) - 1;
+        auto constexpr bit   = I * WIDTH;
+        auto constexpr index = bit / 64;
+        auto constexpr shift = bit % 64;
+
+        if constexpr (shift + WIDTH <= 64) {
+            return (data[index] >> shift) & mask;
+        } else {
+            return ((data[index] >> shift) | (data[index + 1] << (64 - shift)))
+                   & mask;
+        }
+    }
+
+    // Every shift and word index is a constant, and the running value is
+    // the only dependency between the values. Returns the last value.
+    template<int WIDTH, std::size_t... I>
+    static auto unpack_group(std::uint64_t const* data,
+                             std::int64_t const step,
+                             std::int64_t const offset,
+                             std::int64_t value,
+                             std::int64_t* values,
+                             std::index_sequence<I...>) -> std::int64_t
+    {
+        ((value += (std::int64_t)unpack_value<WIDTH, I>(data) * step + offset,
+          values[I] = value),
+         ...);
+
+        return value;
+    }
+
+    // 64 values take exactly WIDTH words, so both halves of a block are
+    // unpacked with the same shifts
+    template<int WIDTH>
+    static auto unpack_full_block(std::uint64_t const* data,
+                                  std::int64_t const step,
+                                  std::int64_t const offset,
+                                  std::int64_t* values) -> void
+    {
+        auto const middle = unpack_group<WIDTH>(data,
+                                                step,
+                                                offset,
+                                                values[0],
+                                                values + 1,
+                                                std::make_index_sequence<64>{});
+        unpack_group<WIDTH>(data + WIDTH,
+                            step,
+                            offset,
+                            middle,
+                            values + 65,
+                            std::make_index_sequence<RATE_HISTORY_BLOCK_DAYS
+                                                     - 65>{});
+    }
+
+    static auto unpack_wide_block(std::uint64_t const* data,
+                                  int const width,
+                                  std::int64_t const step,
+                                  std::int64_t const offset,
+                                  std::int64_t* values) -> void
+    {
+        auto const mask = width == 64 ? ~std::uint64_t{0}
+                                      : (std::uint64_t{1} << width) - 1;
+
+        for (auto i = 1; i < RATE_HISTORY_BLOCK_DAYS; i++) {
+            auto const bit   = (std::uint64_t)(i - 1) * width;
+            auto const index = bit / 64;
+            auto const shift = bit % 64;
+
+            // the second word is shifted in two steps, so a shift of 0 does
+            // not shift it by 64
+            auto const packed = ((data[index] >> shift)
+                                 | ((data[index + 1] << 1) << (63 - shift)))
+                                & mask;
+
+            values[i] = values[i - 1] + (std::int64_t)packed * step + offset;
+        }
+    }
+
+    using unpack_function = void (*)(std::uint64_t const*,
+                                     std::int64_t,
+                                     std::int64_t,
+                                     std::int64_t*);
+
+    template<int... WIDTHS>
+    static constexpr auto
+    make_unpack_functions(std::integer_sequence<int, WIDTHS...>)
+        -> std::array<unpack_function, sizeof...(WIDTHS)>
+    {
+        return {&unpack_full_block<WIDTHS + 1>...};
+    }
+
+    // fixed-point values of a packed block
+    auto unpack_block(block const& b, std::int64_t* values) const -> void
+    {
+        static constexpr auto unpack_functions = make_unpack_functions(
+            std::make_integer_sequence<int, MAX_SPECIALIZED_WIDTH>{});
+
+        auto const step   = POWERS_OF_TEN[b.power];
+        auto const offset = b.min_delta * step;
+
+        values[0] = b.base;
+
+        if (!b.bit_width) {
+            for (auto i = 1; i < b.count; i++) {
+                values[i] = values[i - 1] + offset;
+            }
+        } else if (b.bit_width <= MAX_SPECIALIZED_WIDTH) {
+            unpack_functions[b.bit_width - 1](
+                words.data() + b.offset, step, offset, values);
+        } else {
+            unpack_wide_block(
+                words.data() + b.offset, b.bit_width, step, offset, values);
+        }
+    }
+
+  public:
+    // index of the first day the column has a value for
+    int first_day_index = 0;
+
+    auto append(std::int64_t const value) -> void
+    {
+        open_block.push_back(value);
+        last_value = value;
+
+        if ((int)open_block.size() == RATE_HISTORY_BLOCK_DAYS) {
+            pack_open_block();
+        }
+    }
+
+    // A packed last block is unpacked into the open one and packed again.
+    auto replace_last(std::int64_t const value) -> void
+    {
+        if (open_block.empty()) {
+            auto const& b = blocks.back();
+
+            open_block.resize(b.count);
+            unpack_block(b, open_block.data());
+
+            // the block starts at a word of its own
+            words.resize(b.offset + 1);
+            words.back() = 0;
+            blocks.pop_back();
+        }
+
+        open_block.back() = value;
+        last_value        = value;
+
+        if ((int)open_block.size() == RATE_HISTORY_BLOCK_DAYS) {
+            pack_open_block();
+        }
+    }
+
+    auto size() const -> int
+    {
+        return (int)(blocks.size() * RATE_HISTORY_BLOCK_DAYS
+                     + open_block.size());
+    }
+
+    auto last() const -> std::int64_t
+    {
+        return last_value;
+    }
+
+    // Hands the fixed-point values of [from, to) to f one block at a time,
+    // as f(values, count, index of the first value).
+    template<typename F>
+    auto for_each_block(int const from, int const to, F&& f) const -> void
+    {
+        std::int64_t values[RATE_HISTORY_BLOCK_DAYS];
+
+        auto index = std::max(from, 0);
+        while (index < std::min(to, size())) {
+            auto const block_index = index / RATE_HISTORY_BLOCK_DAYS;
+            auto const block_start = block_index * RATE_HISTORY_BLOCK_DAYS;
+
+            std::int64_t const* block_values = nullptr;
+            auto block_count                 = 0;
+            if (block_index < (int)blocks.size()) {
+                unpack_block(blocks[block_index], values);
+                block_values = values;
+                block_count  = blocks[block_index].count;
+            } else {
+                block_values = open_block.data();
+                block_count  = (int)open_block.size();
+            }
+
+            auto const begin = index - block_start;
+            auto const end   = std::min(to - block_start, block_count);
+            f(block_values + begin, end - begin, index);
+
+            index = block_start + end;
+        }
+    }
+
+    auto footprint_bytes() const -> std::size_t
+    {
+        return blocks.size() * sizeof(block)
+               + words.size() * sizeof(std::uint64_t)
+               + open_block.size() * sizeof(std::int64_t);
+    }
+};
+
+
+// All the tables seen so far, in the order of their dates. A currency that is
+// missing from a table keeps its previous rate on that day.
+struct rate_history {
+  private:
+    std::vector<int> days;
+    std::map<std::string, rate_history_column> columns;
+
+    // day_rows[day - days.front()] is the index of the last table published
+    // on or before the day
+    std::vector<int> day_rows;
+
+    // every value of every column, unpacked
+    auto unpack_columns() const
+        -> std::map<std::string, std::vector<std::int64_t>>
+    {
+        std::map<std::string, std::vector<std::int64_t>> result;
+        for (auto const& [code, column] : columns) {
+            auto& values = result[code];
+            column.for_each_block(
+                0,
+                column.size(),
+                [&](std::int64_t const* block, int const count, int) {
+                    values.insert(values.end(), block, block + count);
+                });
+        }
+
+        return result;
+    }
+
+  public:
+    // The tables hand the rates over as floats, whose digits past the
+    // seventh significant one are noise; they are rounded away so that a
+    // quoted 4.5393 is stored as 453930000 and not as 453929996.
+    static auto to_fixed_point(double const rate) -> std::int64_t
+    {
+        if (rate <= 0) {
+            return std::llround(rate * RATE_HISTORY_PER_UNIT);
+        }
+
+        auto const magnitude = (int)std::floor(std::log10(rate));
+        auto const decimals =
+            std::clamp(RATE_HISTORY_SIGNIFICANT_DIGITS - 1 - magnitude,
+                       0,
+                       RATE_HISTORY_DECIMALS);
+
+        auto value = std::llround(rate * std::pow(10.0, decimals));
+        for (auto i = decimals; i < RATE_HISTORY_DECIMALS; i++) {
+            value *= 10;
+        }
+
+        return value;
+    }
+
+    static auto from_fixed_point(std::int64_t const value) -> double
+    {
+        return value * RATE_HISTORY_UNIT;
+    }
+
+    // Returns false for a table that is not newer than the last one.
+    auto append(std::string const& date,
+                std::vector<currency_rate> const& rates) -> bool
+    {
+        std::map<std::string, std::int64_t> values;
+        for (auto const& each : rates) {
+            values[each.code] = to_fixed_point(each.rate);
+        }
+
+        return append_fixed_point(date_to_days(date), values);
+    }
+
+    auto append_fixed_point(int const day,
+                            std::map<std::string, std::int64_t> const& values)
+        -> bool
+    {
+        if (day == -1 || (!days.empty() && day <= days.back())) {
+            return false;
+        }
+
+        auto const day_index = (int)days.size();
+        days.push_back(day);
+
+        // the days since the previous table keep pointing at it
+        day_rows.resize(day - days.front() + 1, day_index - 1);
+        day_rows.back() = day_index;
+
+        for (auto const& [code, value] : values) {
+            auto& column = columns[code];
+            if (column.size() == 0) {
+                column.first_day_index = day_index;
+            }
+            column.append(value);
+        }
+
+        for (auto& [code, column] : columns) {
+            if (column.first_day_index + column.size() == day_index) {
+                column.append(column.last());
+            }
+        }
+
+        return true;
+    }
+
+    // Adds the rates to the last day, replacing the ones it has, e.g. the NBP
+    // table B that arrives after the table A of the day. Returns false if
+    // there are no days.
+    auto merge_last_day(std::vector<currency_rate> const& rates) -> bool
+    {
+        if (days.empty()) {
+            return false;
+        }
+
+        auto const day_index = (int)days.size() - 1;
+        for (auto const& each : rates) {
+            auto const value = to_fixed_point(each.rate);
+
+            auto& column = columns[each.code];
+            if (column.size() == 0) {
+                column.first_day_index = day_index;
+                column.append(value);
+            } else {
+                column.replace_last(value);
+            }
+        }
+
+        return true;
+    }
+
+    // the last day holds every one of the rates already
+    auto last_day_has(std::vector<currency_rate> const& rates) const -> bool
+    {
+        if (days.empty()) {
+            return false;
+        }
+
+        return std::all_of(rates.begin(), rates.end(), [&](auto const& each) {
+            auto const it = columns.find(each.code);
+            return it != columns.end() && it->second.size() != 0
+                   && it->second.last() == to_fixed_point(each.rate);
+        });
+    }
+
+    // Appends every day of a history that starts after this one ends, e.g.
+    // the kept tables after a backfilled older range. The values are copied
+    // as they are, column by column. Returns false if the histories overlap.
+    auto append_history(rate_history const& newer) -> bool
+    {
+        if (newer.days.empty()) {
+            return true;
+        }
+        if (!days.empty() && newer.days.front() <= days.back()) {
+            return false;
+        }
+
+        auto newer_columns = newer.unpack_columns();
+
+        std::map<std::string, std::int64_t> values;
+        for (auto i = 0; i < newer.days_count(); i++) {
+            values.clear();
+            for (auto const& [code, column] : newer.columns) {
+                if (i >= column.first_day_index) {
+                    values[code] =
+                        newer_columns[code][i - column.first_day_index];
+                }
+            }
+
+            append_fixed_point(newer.days[i], values);
+        }
+
+        return true;
+    }
+
+    // in the format described at the top of the file
+    auto write(std::ostream& out) const -> void
+    {
+        out << RATE_HISTORY_FILE_MAGIC << ' ' << RATE_HISTORY_DECIMALS << '\n';
+
+        out << "codes";
+        for (auto const& [code, column] : columns) {
+            out << ' ' << code;
+        }
+        out << '\n';
+
+        auto const values = unpack_columns();
+        for (auto i = 0; i < days_count(); i++) {
+            out << days_to_date(days[i]);
+            for (auto const& [code, column] : columns) {
+                if (i < column.first_day_index) {
+                    out << " -";
+                } else {
+                    out << ' '
+                        << values.at(code)[i - column.first_day_index];
+                }
+            }
+            out << '\n';
+        }
+    }
+
+    // Replaces the history with one written by write(). Returns false, and
+    // leaves the history empty, if the input is not such a history.
+    auto read(std::istream& in) -> bool
+    {
+        *this = rate_history{};
+
+        auto magic    = std::string{};
+        auto decimals = int{0};
+        auto line     = std::string{};
+        if (!(in >> magic >> decimals) || magic != RATE_HISTORY_FILE_MAGIC
+            || decimals != RATE_HISTORY_DECIMALS || !std::getline(in, line)
+            || !std::getline(in, line)) {
+            return false;
+        }
+
+        auto codes_ss = std::istringstream{line};
+        auto codes    = std::vector<std::string>{};
+        auto word     = std::string{};
+        codes_ss >> word;
+        if (word != "codes") {
+            return false;
+        }
+        while (codes_ss >> word) {
+            codes.push_back(word);
+        }
+
+        std::map<std::string, std::int64_t> values;
+        while (std::getline(in, line)) {
+            if (line.empty()) {
+                continue;
+            }
+
+            auto line_ss = std::istringstream{line};
+            auto date    = std::string{};
+            line_ss >> date;
+
+            values.clear();
+            for (auto const& code : codes) {
+                if (!(line_ss >> word)) {
+                    *this = rate_history{};
+                    return false;
+                }
+                if (word != "-") {
+                    values[code] = std::stoll(word);
+                }
+            }
+
+            if (!append_fixed_point(date_to_days(date), values)) {
+                *this = rate_history{};
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    auto days_count() const -> int
+    {
+        return (int)days.size();
+    }
+
+    auto day(int const day_index) const -> int
+    {
+        return days[day_index];
+    }
+
+    // index of the last day not after the date, -1 if there is none
+    auto day_index_at_or_before(int const day) const -> int
+    {
+        if (days.empty() || day < days.front()) {
+            return -1;
+        }
+        if (day >= days.back()) {
+            return (int)days.size() - 1;
+        }
+
+        return day_rows[day - days.front()];
+    }
+
+    // Rates of every currency that had one on the day, in PLN.
+    auto rates_at(int const day_index) const -> std::map<std::string, float>
+    {
+        std::map<std::string, float> result;
+        for (auto const& [code, column] : columns) {
+            column.for_each_block(
+                day_index - column.first_day_index,
+                day_index - column.first_day_index + 1,
+                [&](std::int64_t const* values, int const count, int) {
+                    if (count) {
+                        result[code] = (float)from_fixed_point(values[0]);
+                    }
+                });
+        }
+
+        return result;
+    }
+
+    auto has_currency(std::string const& code) const -> bool
+    {
+        return columns.count(code);
+    }
+
+    auto currency_codes() const -> std::vector<std::string>
+    {
+        std::vector<std::string> result;
+        for (auto const& [code, column] : columns) {
+            result.push_back(code);
+        }
+
+        return result;
+    }
+
+    auto column(std::string const& code) const -> rate_history_column const*
+    {
+        auto const it = columns.find(code);
+        return it == columns.end() ? nullptr : &it->second;
+    }
+
+    // Hands the fixed-point rates of the days [from, to) to f one block at
+    // a time, as f(values, count, day index of the first value). Days before
+    // the currency first appeared are skipped.
+    template<typename F>
+    auto for_each_block(std::string const& code,
+                        int const from,
+                        int const to,
+                        F&& f) const -> void
+    {
+        auto const* const c = column(code);
+        if (!c) {
+            return;
+        }
+
+        c->for_each_block(from - c->first_day_index,
+                          to - c->first_day_index,
+                          [&](std::int64_t const* values,
+                              int const count,
+                              int const index) {
+                              f(values, count, index + c->first_day_index);
+                          });
+    }
+
+    // index of the first day the currency has a rate for, PLN has all days
+    auto first_day_index(std::string const& code) const -> int
+    {
+        if (code == "PLN") {
+            return 0;
+        }
+
+        auto const* const c = column(code);
+        return c ? c->first_day_index : days_count();
+    }
+
+    // Hands the rates of the currency in the base currency for the days
+    // [from, to) to f at most a block at a time, as f(rates, count, day index
+    // of the first rate). Both currencies are unpacked block by block into a
+    // buffer on the stack, so no converted column is made.
+    template<typename F>
+    auto for_each_cross_rate_chunk(std::string const& code,
+                                   std::string const& base,
+                                   int from,
+                                   int to,
+                                   F&& f) const -> void
+    {
+        from = std::max({from, first_day_index(code), first_day_index(base)});
+        to   = std::min(to, days_count());
+
+        double rates[RATE_HISTORY_BLOCK_DAYS];
+
+        auto const divide_by_base = [&](int const count, int const index) {
+            if (base == "PLN") {
+                return;
+            }
+
+            for_each_block(
+                base,
+                index,
+                index + count,
+                [&](std::int64_t const* values,
+                    int const values_count,
+                    int const values_index) {
+                    auto* const chunk = rates + (values_index - index);
+                    for (auto i = 0; i < values_count; i++) {
+                        chunk[i] /= from_fixed_point(values[i]);
+                    }
+                });
+        };
+
+        if (code == "PLN") {
+            for (auto index = from; index < to;
+                 index += RATE_HISTORY_BLOCK_DAYS) {
+                auto const count =
+                    std::min(RATE_HISTORY_BLOCK_DAYS, to - index);
+                std::fill(rates, rates + count, 1.0);
+
+                divide_by_base(count, index);
+                f((double const*)rates, count, index);
+            }
+            return;
+        }
+
+        for_each_block(
+            code,
+            from,
+            to,
+            [&](std::int64_t const* values, int const count, int const index) {
+                for (auto i = 0; i < count; i++) {
+                    rates[i] = from_fixed_point(values[i]);
+                }
+
+                divide_by_base(count, index);
+                f((double const*)rates, count, index);
+            });
+    }
+
+    auto footprint_bytes() const -> std::size_t
+    {
+        auto result = (days.size() + day_rows.size()) * sizeof(int);
+        for (auto const& [code, column] : columns) {
+            result += column.footprint_bytes();
+        }
+
+        return result;
+    }
+};
+
+
+
+// Best-effort: returns false if the file cannot be written.
+inline auto save_rate_history(std::string const& file_path,
+                              rate_history const& history) -> bool
+{
+    auto out = std::ostringstream{};
+    history.write(out);
+
+    return write_gzip_file(file_path, out.str());
+}
+
+
+// Returns false, leaving the history empty, if the file is missing or is not
+// a saved history.
+inline auto load_rate_history(std::string const& file_path,
+                              rate_history& history) -> bool
+{
+    auto buffer = gzip_file_buffer{file_path};
+    if (!buffer.is_open()) {
+        history = rate_history{};
+        return false;
+    }
+    std::istream file{&buffer};
+
+    try {
+        return history.read(file);
+    } catch (...) {
+        history = rate_history{};
+        return false;
+    }
+}
+
+#endif
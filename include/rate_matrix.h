@@ -0,0 +1,265 @@
+/*
+console NBP currency converter
+
+MIT License
+
+Copyright (c) 2021 Kajetan Welc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+The grid of the cross rates of a set of currencies: row i holds the value of
+one unit of currency i in every currency of the set. The rows are worked out
+in bands of MATRIX_BAND_ROWS, one block of columns at a time, and every band
+is written out as soon as it is done, so the memory does not grow with the
+grid.
+*/
+
+#ifndef RATE_MATRIX_H
+#define RATE_MATRIX_H
+
+#include <currency_table_renderer.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+int const MATRIX_BAND_ROWS     = 16;
+int const MATRIX_BLOCK_COLUMNS = 64;
+
+// significant digits of the rates of the csv and jsonl formats
+int const MATRIX_SIGNIFICANT_DIGITS = 6;
+
+enum class rate_matrix_format { csv, jsonl, table };
+
+
+struct rate_matrix_writer {
+  private:
+    using style = bold2_table_style;
+
+    static constexpr std::string_view CODES_HEADER = "Currency";
+
+    std::vector<std::string> codes;
+    std::vector<double> rates;
+    rate_matrix_format format;
+    int decimal_points;
+
+    // widths of the table format, the codes column first
+    std::vector<int> column_widths;
+
+    // csv and jsonl
+    static auto append_rate(std::string& out, double const rate) -> void
+    {
+        char text[64];
+        auto const length = std::snprintf(
+            text, sizeof(text), "%.*g", MATRIX_SIGNIFICANT_DIGITS, rate);
+        out.append(text, length);
+    }
+
+    auto append_table_rate(std::string& out,
+                           double const rate,
+                           int const column) const -> void
+    {
+        char text[64];
+        auto const length =
+            std::snprintf(text, sizeof(text), "%.*f", decimal_points, rate);
+        style::append_cell(out,
+                           {text, (std::size_t)length},
+                           length,
+                           column_widths[column],
+                           style::align::right,
+                           false);
+    }
+
+    // The widest rate of a column is its largest, so one pass over the rates
+    // gives every width before the first row is written.
+    auto make_column_widths() -> void
+    {
+        auto const max_rate = *std::max_element(rates.begin(), rates.end());
+
+        char text[64];
+        column_widths.assign(1, (int)CODES_HEADER.size());
+        for (auto j = 0; j < (int)codes.size(); j++) {
+            column_widths[0] =
+                std::max(column_widths[0], (int)codes[j].size());
+
+            auto const length = std::snprintf(text,
+                                              sizeof(text),
+                                              "%.*f",
+                                              decimal_points,
+                                              max_rate / rates[j]);
+            column_widths.push_back(std::max((int)codes[j].size(), length));
+        }
+    }
+
+    auto append_header(std::string& out) const -> void
+    {
+        if (format == rate_matrix_format::csv) {
+            out += "currency";
+            for (auto const& code : codes) {
+                out += ',';
+                out += code;
+            }
+            out += '\n';
+        } else if (format == rate_matrix_format::table) {
+            style::append_line(out, style::TOP_LINE, column_widths);
+
+            out += style::OUTER_BORDER;
+            style::append_cell(out,
+                               CODES_HEADER,
+                               (int)CODES_HEADER.size(),
+                               column_widths[0],
+                               style::align::center,
+                               true);
+            for (auto j = 0; j < (int)codes.size(); j++) {
+                out += style::INNER_BORDER;
+                style::append_cell(out,
+                                   codes[j],
+                                   (int)codes[j].size(),
+                                   column_widths[j + 1],
+                                   style::align::center,
+                                   true);
+            }
+            out += style::OUTER_BORDER;
+            out += '\n';
+        }
+    }
+
+    auto append_footer(std::string& out) const -> void
+    {
+        if (format == rate_matrix_format::table) {
+            style::append_line(out, style::BOTTOM_LINE, column_widths);
+        }
+    }
+
+    // the rows [from, to), blocks of columns at a time
+    auto append_band(std::string& out, int const from, int const to) const
+        -> void
+    {
+        auto const size = (int)codes.size();
+
+        std::vector<std::string> rows(to - from);
+        for (auto i = from; i < to; i++) {
+            auto& row = rows[i - from];
+            if (format == rate_matrix_format::csv) {
+                row += codes[i];
+            } else if (format == rate_matrix_format::jsonl) {
+                row += "{\"currency\":\"";
+                row += codes[i];
+                row += "\",\"rates\":{";
+            } else {
+                style::append_line(row,
+                                   i ? style::ROW_LINE : style::HEADER_LINE,
+                                   column_widths);
+                row += style::OUTER_BORDER;
+                style::append_cell(row,
+                                   codes[i],
+                                   (int)codes[i].size(),
+                                   column_widths[0],
+                                   style::align::center,
+                                   false);
+            }
+        }
+
+        double values[MATRIX_BAND_ROWS][MATRIX_BLOCK_COLUMNS];
+
+        for (auto block = 0; block < size; block += MATRIX_BLOCK_COLUMNS) {
+            auto const block_end = std::min(block + MATRIX_BLOCK_COLUMNS, size);
+
+            for (auto i = from; i < to; i++) {
+                for (auto j = block; j < block_end; j++) {
+                    values[i - from][j - block] = rates[i] / rates[j];
+                }
+            }
+
+            for (auto i = from; i < to; i++) {
+                auto& row = rows[i - from];
+                for (auto j = block; j < block_end; j++) {
+                    if (format == rate_matrix_format::csv) {
+                        row += ',';
+                        append_rate(row, values[i - from][j - block]);
+                    } else if (format == rate_matrix_format::jsonl) {
+                        if (j) {
+                            row += ',';
+                        }
+                        row += '"';
+                        row += codes[j];
+                        row += "\":";
+                        append_rate(row, values[i - from][j - block]);
+                    } else {
+                        row += style::INNER_BORDER;
+                        append_table_rate(
+                            row, values[i - from][j - block], j + 1);
+                    }
+                }
+            }
+        }
+
+        for (auto& row : rows) {
+            if (format == rate_matrix_format::jsonl) {
+                row += "}}";
+            } else if (format == rate_matrix_format::table) {
+                row += style::OUTER_BORDER;
+            }
+            out += row;
+            out += '\n';
+        }
+    }
+
+  public:
+    // rates hold the value of one unit of each currency in a common one
+    rate_matrix_writer(std::vector<std::string> c,
+                       std::vector<double> r,
+                       rate_matrix_format const f,
+                       int const d)
+        : codes{std::move(c)}
+        , rates{std::move(r)}
+        , format{f}
+        , decimal_points{d}
+    {
+        if (format == rate_matrix_format::table && !codes.empty()) {
+            make_column_widths();
+        }
+    }
+
+    auto write(std::ostream& out) const -> void
+    {
+        auto text = std::string{};
+        append_header(text);
+        out << text << std::flush;
+
+        // one buffer serves every band
+        auto const size = (int)codes.size();
+        for (auto from = 0; from < size; from += MATRIX_BAND_ROWS) {
+            text.clear();
+            append_band(text, from, std::min(from + MATRIX_BAND_ROWS, size));
+            out << text << std::flush;
+        }
+
+        text.clear();
+        append_footer(text);
+        out << text << std::flush;
+    }
+};
+
+#endif
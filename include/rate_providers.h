@@ -0,0 +1,863 @@
+/*
+console NBP currency converter
+
+MIT License
+
+Copyright (c) 2021 Kajetan Welc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+Sources of exchange rate tables. Every provider turns its own format into a
+rate_table with rates expressed in PLN, so the converter does not need to know
+where a snapshot came from.
+*/
+
+#ifndef RATE_PROVIDERS_H
+#define RATE_PROVIDERS_H
+
+#include <cpr/cpr.h>  // https://github.com/whoshuu/cpr
+#include <currency_rate.h>
+#include <fetch_stats.h>
+#include <gzip_file.h>
+#include <http_client.h>
+#include <iso4217.h>
+#include <nbp_table_parser.h>
+#include <nlohmann/json.hpp>  // https://github.com/nlohmann/json
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <future>
+#include <istream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+// how long a valid table of a lower priority provider waits for the higher
+// priority ones to finish
+int const RATE_PROVIDERS_FALLBACK_DELAY_MS = 500;
+
+
+// Every vector is sorted by code and holds a code at most once.
+struct rate_table {
+    std::string publication_date;
+
+    // mid rates in PLN, with the NBP table and the effective date they come
+    // from; the other sources leave the table 0 and date them by the
+    // publication date
+    std::vector<currency_rate> rates;
+
+    // polish currency names, only known to the NBP tables
+    std::vector<std::pair<std::string, std::string>> names;
+
+    // table C of NBP
+    std::vector<currency_bid_ask> bid_ask_rates;
+
+    // nullptr if the table has no name of the code
+    auto name(std::string const& code) const -> std::string const*
+    {
+        auto const it = std::lower_bound(
+            names.begin(), names.end(), code, [](auto const& each, auto& c) {
+                return each.first < c;
+            });
+
+        return it != names.end() && it->first == code ? &it->second : nullptr;
+    }
+};
+
+
+// moves the items of from to the end of to, or the whole vector if to is empty
+template<typename T>
+auto move_append(std::vector<T>& to, std::vector<T>& from) -> void
+{
+    if (to.empty()) {
+        to = std::move(from);
+        return;
+    }
+
+    to.insert(to.end(),
+              std::make_move_iterator(from.begin()),
+              std::make_move_iterator(from.end()));
+}
+
+
+// Joins the tables of every NBP table letter into one, moving their rates.
+// Tables A and B quote mid rates of different currencies; should they ever
+// overlap, the earlier letter wins. Table C only adds bid and ask rates. The
+// publication date is the one of table A, or the newest one without it.
+inline auto merge_nbp_tables(std::map<char, rate_table> tables) -> rate_table
+{
+    auto result = rate_table{};
+
+    for (auto& [letter, table] : tables) {
+        if (result.publication_date.empty() || letter == 'A'
+            || (!tables.count('A')
+                && result.publication_date < table.publication_date)) {
+            result.publication_date = table.publication_date;
+        }
+
+        move_append(result.rates, table.rates);
+        move_append(result.bid_ask_rates, table.bid_ask_rates);
+        move_append(result.names, table.names);
+    }
+
+    // a single table is sorted already
+    if (tables.size() > 1) {
+        sort_unique_by_code(result.rates, &currency_rate::code);
+        sort_unique_by_code(result.bid_ask_rates, &currency_bid_ask::code);
+        sort_unique_by_code(
+            result.names, &std::pair<std::string, std::string>::first);
+    }
+
+    return result;
+}
+
+
+struct pending_rate_tables;
+
+
+struct rate_provider_result {
+    bool ok = false;
+    rate_table table;
+    std::string error;
+
+    fetch_record record;
+
+    // the tables the provider goes on fetching, nullptr if there are none
+    std::shared_ptr<pending_rate_tables> pending;
+};
+
+
+// Tables that a provider goes on fetching after it has returned its result,
+// e.g. the NBP tables B and C. Dropping them cancels the fetch and waits for
+// it, so no thread outlives them.
+struct pending_rate_tables {
+    std::atomic<bool> cancelled{false};
+    std::future<rate_provider_result> result;
+
+    pending_rate_tables() = default;
+    pending_rate_tables(pending_rate_tables const&) = delete;
+    auto operator=(pending_rate_tables const&) -> pending_rate_tables& = delete;
+
+    ~pending_rate_tables()
+    {
+        cancelled = true;
+        if (result.valid()) {
+            result.wait();
+        }
+    }
+};
+
+
+struct rate_provider {
+    // lower values win when several providers succeed at the same time
+    int priority = 0;
+
+    // only asked once every other provider has failed, and its table is
+    // reported as stale, e.g. the cache of the tables fetched earlier
+    bool last_resort = false;
+
+    virtual ~rate_provider() = default;
+
+    virtual auto name() const -> std::string = 0;
+
+    virtual auto fetch(std::atomic<bool> const& cancelled)
+        -> rate_provider_result = 0;
+
+  protected:
+    int const TIMEOUT_MS = 10000;
+
+    // parses the body and notes the timings of both steps in the result
+    template<typename Parse>
+    auto timed_parse(http_timings const& timings,
+                     std::string const& body,
+                     Parse parse) -> rate_provider_result
+    {
+        auto const parse_start = std::chrono::steady_clock::now();
+
+        auto result            = parse(body);
+        result.record.source   = name();
+        result.record.http     = timings;
+        result.record.parse_ms = milliseconds_since(parse_start);
+
+        return result;
+    }
+
+    static auto make_error(std::string const& error) -> rate_provider_result
+    {
+        auto result  = rate_provider_result{};
+        result.error = error;
+
+        return result;
+    }
+
+    // Keeps the last table of every letter in the response, which is the
+    // newest one as NBP lists the tables in chronological order. Tables
+    // without a letter are taken for table A.
+    struct rate_table_sink : nbp_table_sink {
+        std::map<char, rate_table> tables;
+
+        rate_table table;
+        char letter = 'A';
+
+        auto table_begin() -> void override
+        {
+            table  = rate_table{};
+            letter = 'A';
+
+            // no table quotes more currencies than the registry has
+            table.rates.reserve(ISO4217_CURRENCIES_COUNT);
+            table.names.reserve(ISO4217_CURRENCIES_COUNT);
+        }
+
+        auto table_name(std::string const& name) -> void override
+        {
+            if (!name.empty()) {
+                letter = (char)std::toupper((unsigned char)name[0]);
+            }
+        }
+
+        auto effective_date(std::string const& date) -> void override
+        {
+            table.publication_date = date;
+        }
+
+        auto rate(std::string const& code,
+                  double const& mid,
+                  std::string const& name) -> void override
+        {
+            table.rates.push_back({code, (float)mid, 0, {}});
+            table.names.emplace_back(code, name);
+        }
+
+        auto bid_ask_rate(std::string const& code,
+                          double const& bid,
+                          double const& ask,
+                          std::string const& name) -> void override
+        {
+            table.bid_ask_rates.push_back(
+                {code, (float)bid, (float)ask, 0, {}});
+            table.names.emplace_back(code, name);
+        }
+
+        // the letter and the date may come after the rates
+        auto table_end() -> void override
+        {
+            for (auto& each : table.rates) {
+                each.table          = letter;
+                each.effective_date = table.publication_date;
+            }
+            for (auto& each : table.bid_ask_rates) {
+                each.table          = letter;
+                each.effective_date = table.publication_date;
+            }
+
+            sort_unique_by_code(table.rates, &currency_rate::code);
+            sort_unique_by_code(table.bid_ask_rates, &currency_bid_ask::code);
+            sort_unique_by_code(
+                table.names, &std::pair<std::string, std::string>::first);
+
+            tables[letter] = std::move(table);
+        }
+    };
+
+    // tables of the NBP Web API, see nbp_table_parser.h
+    static auto parse_nbp_json(std::string const& str) -> rate_provider_result
+    {
+        auto result = rate_provider_result{};
+        auto sink   = rate_table_sink{};
+
+        result.ok = parse_nbp_tables(str, sink);
+        if (!result.ok) {
+            result.error = "NBP API parse error";
+        }
+        result.table = merge_nbp_tables(std::move(sink.tables));
+
+        return result;
+    }
+
+    static auto find_xml_attribute(std::string const& str,
+                                   std::string const& attribute,
+                                   std::size_t& position) -> std::string
+    {
+        auto const attribute_index = str.find(attribute + "=", position);
+        if (attribute_index == std::string::npos) {
+            position = std::string::npos;
+            return "";
+        }
+
+        auto const quote_index = attribute_index + attribute.size() + 1;
+        if (quote_index >= str.size()) {
+            position = std::string::npos;
+            return "";
+        }
+
+        auto const quote     = str[quote_index];
+        auto const end_index = str.find(quote, quote_index + 1);
+        if (end_index == std::string::npos) {
+            position = std::string::npos;
+            return "";
+        }
+
+        position = end_index + 1;
+        return str.substr(quote_index + 1, end_index - quote_index - 1);
+    }
+
+    // ECB euro foreign exchange reference rates, e.g.
+    // <Cube time='2021-03-03'><Cube currency='USD' rate='1.2070'/>...
+    // The rates are quoted per EUR, so they are rebased on the PLN quote.
+    static auto parse_ecb_xml(std::string const& str) -> rate_provider_result
+    {
+        auto result = rate_provider_result{};
+
+        auto position = std::size_t{0};
+        result.table.publication_date =
+            find_xml_attribute(str, "time", position);
+        if (position == std::string::npos) {
+            return make_error("ECB API parse error");
+        }
+
+        std::map<std::string, float> rates_per_eur;
+        while (true) {
+            auto const code = find_xml_attribute(str, "currency", position);
+            if (position == std::string::npos) {
+                break;
+            }
+
+            auto const rate = find_xml_attribute(str, "rate", position);
+            if (position == std::string::npos) {
+                return make_error("ECB API parse error");
+            }
+
+            try {
+                rates_per_eur[code] = std::stof(rate);
+            } catch (...) {
+                return make_error("ECB API parse error");
+            }
+        }
+
+        if (!rates_per_eur.count("PLN") || rates_per_eur["PLN"] <= 0) {
+            return make_error("ECB API parse error");
+        }
+
+        auto const pln_per_eur = rates_per_eur["PLN"];
+        auto const& date       = result.table.publication_date;
+
+        auto& rates = result.table.rates;
+        rates.push_back({"EUR", pln_per_eur, 0, date});
+        for (auto const& [code, rate] : rates_per_eur) {
+            if (code != "PLN" && rate > 0) {
+                rates.push_back({code, pln_per_eur / rate, 0, date});
+            }
+        }
+        sort_unique_by_code(rates, &currency_rate::code);
+
+        result.ok = true;
+        return result;
+    }
+};
+
+
+// Fetches the NBP tables at the same time. The first url is the required
+// table A, which is returned as soon as it is parsed; the others (tables B and
+// C) only add currencies and bid and ask rates, so they are merged and handed
+// over later as the pending tables of the result.
+struct nbp_json_provider : rate_provider {
+    std::vector<cpr::Url> const urls;
+
+    nbp_json_provider(std::vector<cpr::Url> u, int p) : urls{std::move(u)}
+    {
+        priority = p;
+    }
+
+    auto name() const -> std::string override
+    {
+        return "NBP";
+    }
+
+    auto fetch(std::atomic<bool> const& cancelled)
+        -> rate_provider_result override
+    {
+        if (urls.empty()) {
+            return make_error("NBP HTTP request error");
+        }
+
+        // The pending tables own the flag the fetch reads, and wait for the
+        // fetch before they release it. The race of the providers cancels
+        // table A only.
+        auto pending = std::shared_ptr<pending_rate_tables>{};
+        if (urls.size() > 1) {
+            pending = std::make_shared<pending_rate_tables>();
+
+            auto later_urls = std::vector<std::string>{};
+            for (auto i = std::size_t{1}; i < urls.size(); i++) {
+                later_urls.push_back(std::string(urls[i]));
+            }
+
+            pending->result = std::async(
+                std::launch::async,
+                [later_urls = std::move(later_urls),
+                 &later_cancelled = pending->cancelled,
+                 timeout_ms = TIMEOUT_MS] {
+                    return fetch_tables(
+                        later_urls, later_cancelled, timeout_ms);
+                });
+        }
+
+        auto table_a = table_fetch{};
+        fetch_table(std::string(urls[0]), cancelled, TIMEOUT_MS, table_a);
+
+        auto const& response = table_a.response;
+        if (!response.error.empty() || response.status_code >= 400) {
+            return make_error("NBP HTTP request error");
+        }
+
+        if (!table_a.parsed) {
+            return make_error("NBP API parse error");
+        }
+
+        auto result  = rate_provider_result{};
+        result.table = merge_nbp_tables(std::move(table_a.sink.tables));
+
+        result.ok              = true;
+        result.record.source   = name();
+        result.record.http     = response.timings;
+        result.record.parse_ms = table_a.parse_ms;
+        result.pending         = std::move(pending);
+
+        return result;
+    }
+
+  private:
+    struct table_fetch {
+        rate_table_sink sink;
+        http_response response;
+        bool parsed     = false;
+        double parse_ms = 0;
+
+        auto ok() const -> bool
+        {
+            return response.error.empty() && response.status_code < 400
+                   && parsed;
+        }
+
+        auto wait_ms() const -> double
+        {
+            return response.timings.total_ms + parse_ms;
+        }
+    };
+
+    // Fetches the tables at the same time and merges the ones that arrive.
+    // Fails only if none of them does.
+    static auto fetch_tables(std::vector<std::string> const& table_urls,
+                             std::atomic<bool> const& cancelled,
+                             long const timeout_ms) -> rate_provider_result
+    {
+        auto const urls_size = (int)table_urls.size();
+
+        std::vector<table_fetch> fetches(urls_size);
+        std::vector<std::thread> threads;
+        for (auto i = 0; i < urls_size; i++) {
+            threads.push_back(std::thread{[&, i] {
+                fetch_table(table_urls[i], cancelled, timeout_ms, fetches[i]);
+            }});
+        }
+        for (auto& each : threads) {
+            each.join();
+        }
+
+        // the slowest of the merged tables is what the fetch waited for
+        auto tables  = std::map<char, rate_table>{};
+        auto slowest = -1;
+        for (auto i = 0; i < urls_size; i++) {
+            auto& each = fetches[i];
+            if (!each.ok()) {
+                continue;
+            }
+
+            for (auto& [letter, table] : each.sink.tables) {
+                tables[letter] = std::move(table);
+            }
+
+            if (slowest == -1 || each.wait_ms() > fetches[slowest].wait_ms()) {
+                slowest = i;
+            }
+        }
+
+        if (slowest == -1) {
+            return make_error("NBP HTTP request error");
+        }
+
+        auto result            = rate_provider_result{};
+        result.ok              = true;
+        result.table           = merge_nbp_tables(std::move(tables));
+        result.record.source   = "NBP B and C";
+        result.record.http     = fetches[slowest].response.timings;
+        result.record.parse_ms = fetches[slowest].parse_ms;
+
+        return result;
+    }
+
+    static auto fetch_table(std::string const& url,
+                            std::atomic<bool> const& cancelled,
+                            long const timeout_ms,
+                            table_fetch& each) -> void
+    {
+        auto parse_end = std::chrono::steady_clock::time_point{};
+
+        // the table is parsed chunk by chunk while it is being downloaded
+        auto const start = std::chrono::steady_clock::now();
+        each.response    = http_get_streamed(
+            url,
+            cancelled,
+            [&](std::istream& body) {
+                each.parsed = parse_nbp_tables(body, each.sink);
+                parse_end   = std::chrono::steady_clock::now();
+            },
+            timeout_ms);
+
+        // only the parsing left after the last byte arrived is counted
+        each.parse_ms = std::max(
+            0.0,
+            std::chrono::duration<double, std::milli>(parse_end - start)
+                    .count()
+                - each.response.timings.total_ms);
+    }
+};
+
+
+struct ecb_xml_provider : rate_provider {
+    cpr::Url const url;
+
+    ecb_xml_provider(cpr::Url u, int p) : url{std::move(u)}
+    {
+        priority = p;
+    }
+
+    auto name() const -> std::string override
+    {
+        return "ECB";
+    }
+
+    auto fetch(std::atomic<bool> const& cancelled)
+        -> rate_provider_result override
+    {
+        auto const response =
+            http_get(std::string(url), cancelled, TIMEOUT_MS);
+
+        if (!response.error.empty() || response.status_code >= 400) {
+            return make_error("ECB HTTP request error");
+        }
+
+        return timed_parse(response.timings, response.text, parse_ecb_xml);
+    }
+};
+
+
+// Reads a saved NBP JSON or ECB XML table, either of which may be gzip
+// compressed. If the path is a directory, the file with the greatest name is
+// used, so files named after their dates yield the newest table.
+struct local_file_provider : rate_provider {
+    std::string const path;
+    std::string const provider_name;
+
+    local_file_provider(std::string p,
+                        int pr,
+                        std::string n = "local file")
+        : path{std::move(p)}
+        , provider_name{std::move(n)}
+    {
+        priority = pr;
+    }
+
+    auto name() const -> std::string override
+    {
+        return provider_name;
+    }
+
+    static auto is_rate_file(std::filesystem::path file_path) -> bool
+    {
+        if (file_path.extension() == ".gz") {
+            file_path = file_path.stem();
+        }
+
+        auto const extension = file_path.extension();
+        return extension == ".json" || extension == ".xml";
+    }
+
+    auto fetch(std::atomic<bool> const&) -> rate_provider_result override
+    {
+        auto const read_start = std::chrono::steady_clock::now();
+
+        auto file_path = std::filesystem::path{path};
+
+        auto ec = std::error_code{};
+        if (std::filesystem::is_directory(file_path, ec)) {
+            auto newest = std::filesystem::path{};
+            for (auto const& entry :
+                 std::filesystem::directory_iterator{file_path, ec}) {
+                if (!entry.is_regular_file() || !is_rate_file(entry.path())) {
+                    continue;
+                }
+
+                if (newest.empty() || newest < entry.path()) {
+                    newest = entry.path();
+                }
+            }
+
+            if (newest.empty()) {
+                return make_error("No rate files in " + path);
+            }
+            file_path = newest;
+        }
+
+        auto buffer = gzip_file_buffer{file_path.string()};
+        if (!buffer.is_open()) {
+            return make_error("Cannot read " + file_path.string());
+        }
+        std::istream file{&buffer};
+
+        // reading and inflating the file counts as the transfer
+        auto timings = http_timings{};
+
+        file >> std::ws;
+        if (file.peek() == '<') {
+            std::stringstream tmp_ss;
+            tmp_ss << file.rdbuf();
+
+            timings.transfer_ms = milliseconds_since(read_start);
+            timings.total_ms    = timings.transfer_ms;
+
+            return timed_parse(timings, tmp_ss.str(), parse_ecb_xml);
+        }
+
+        // the JSON tables are parsed while the file is being inflated
+        auto result  = rate_provider_result{};
+        auto sink    = rate_table_sink{};
+        result.ok    = parse_nbp_tables(file, sink);
+        result.table = merge_nbp_tables(std::move(sink.tables));
+
+        if (!result.ok) {
+            return make_error("NBP API parse error");
+        }
+
+        timings.transfer_ms  = milliseconds_since(read_start);
+        timings.total_ms     = timings.transfer_ms;
+        result.record.source = name();
+        result.record.http   = timings;
+
+        return result;
+    }
+};
+
+
+// The table in the NBP Web API format, so that local_file_provider reads it
+// back. Every rate goes to the table it came from, table A if it has no
+// origin. Names are only written for the currencies that have one.
+inline auto rate_table_to_nbp_json(rate_table const& table) -> std::string
+{
+    std::map<char, nlohmann::json> tables;
+
+    auto const add_rate = [&](std::string const& code,
+                              char const letter,
+                              std::string const& effective_date,
+                              nlohmann::json rate_obj) {
+        auto const* const name = table.name(code);
+        if (name) {
+            rate_obj["currency"] = *name;
+        }
+
+        auto& table_obj = tables[letter];
+        if (table_obj.is_null()) {
+            table_obj = {{"table", std::string(1, letter)},
+                         {"effectiveDate", effective_date},
+                         {"rates", nlohmann::json::array()}};
+        }
+        table_obj["rates"].push_back(rate_obj);
+    };
+
+    for (auto const& rate : table.rates) {
+        auto const has_origin = bool{rate.table != 0};
+
+        add_rate(rate.code,
+                 has_origin ? rate.table : 'A',
+                 has_origin ? rate.effective_date : table.publication_date,
+                 {{"code", rate.code}, {"mid", rate.rate}});
+    }
+
+    for (auto const& rate : table.bid_ask_rates) {
+        add_rate(rate.code,
+                 rate.table,
+                 rate.effective_date,
+                 {{"code", rate.code}, {"bid", rate.bid}, {"ask", rate.ask}});
+    }
+
+    auto result = nlohmann::json::array();
+    for (auto const& [letter, table_obj] : tables) {
+        result.push_back(table_obj);
+    }
+
+    return result.dump();
+}
+
+
+// Runs every provider at once. A valid table is used as soon as every provider
+// with a higher priority has failed, or as soon as it arrives once the fallback
+// delay has passed; the providers still running are then cancelled. The last
+// resort providers are only asked, one by one, when all the others have
+// failed, and stale tells whether the table is theirs. pending gets the
+// pending tables of the winner, if it has any.
+inline auto fetch_first_valid_rate_table(
+    std::vector<std::shared_ptr<rate_provider>> all_providers,
+    rate_table& table,
+    std::string& provider_name,
+    bool& stale,
+    std::vector<std::string>& errors,
+    std::vector<fetch_record>& records,
+    std::shared_ptr<pending_rate_tables>& pending) -> bool
+{
+    std::stable_sort(all_providers.begin(),
+                     all_providers.end(),
+                     [](auto const& a, auto const& b) {
+                         return a->priority < b->priority;
+                     });
+
+    std::vector<std::shared_ptr<rate_provider>> providers;
+    std::vector<std::shared_ptr<rate_provider>> last_resort_providers;
+    for (auto& provider : all_providers) {
+        (provider->last_resort ? last_resort_providers : providers)
+            .push_back(std::move(provider));
+    }
+
+    stale = false;
+
+    auto const providers_size = (int)providers.size();
+
+    std::vector<rate_provider_result> results(providers_size);
+    std::vector<bool> finished(providers_size, false);
+    auto finished_count = int{0};
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::atomic<bool> cancelled{false};
+
+    std::vector<std::thread> threads;
+    for (auto i = 0; i < providers_size; i++) {
+        threads.push_back(std::thread{[&, i] {
+            auto result = providers[i]->fetch(cancelled);
+
+            std::unique_lock<std::mutex> lck{mtx};
+            results[i]  = std::move(result);
+            finished[i] = true;
+            finished_count++;
+            cv.notify_all();
+        }});
+    }
+
+    auto const fallback_deadline =
+        std::chrono::steady_clock::now()
+        + std::chrono::milliseconds{RATE_PROVIDERS_FALLBACK_DELAY_MS};
+
+    auto const find_winner = [&](bool const fallback) -> int {
+        for (auto i = 0; i < providers_size; i++) {
+            if (finished[i] && results[i].ok) {
+                return i;
+            }
+
+            if (!finished[i] && !fallback) {
+                return -1;
+            }
+        }
+
+        return -1;
+    };
+
+    auto winner_index = int{-1};
+    std::vector<bool> finished_in_time;
+    {
+        std::unique_lock<std::mutex> lck{mtx};
+        cv.wait_until(lck, fallback_deadline, [&] {
+            winner_index = find_winner(false);
+            return winner_index != -1 || finished_count == providers_size;
+        });
+
+        if (winner_index == -1) {
+            cv.wait(lck, [&] {
+                winner_index = find_winner(true);
+                return winner_index != -1 || finished_count == providers_size;
+            });
+        }
+
+        finished_in_time = finished;
+    }
+
+    cancelled = true;
+    for (auto& each : threads) {
+        each.join();
+    }
+
+    // the transfers cut short by the cancellation would skew the stats
+    for (auto i = 0; i < providers_size; i++) {
+        if (finished_in_time[i] && results[i].ok) {
+            records.push_back(results[i].record);
+        }
+    }
+
+    if (winner_index != -1) {
+        table         = std::move(results[winner_index].table);
+        provider_name = providers[winner_index]->name();
+        pending       = std::move(results[winner_index].pending);
+
+        return true;
+    }
+
+    for (auto const& result : results) {
+        errors.push_back(result.error);
+    }
+
+    cancelled = false;
+    for (auto const& provider : last_resort_providers) {
+        auto result = provider->fetch(cancelled);
+        if (!result.ok) {
+            errors.push_back(result.error);
+            continue;
+        }
+
+        records.push_back(result.record);
+        table         = std::move(result.table);
+        provider_name = provider->name();
+        stale         = true;
+
+        return true;
+    }
+
+    return false;
+}
+
+#endif
@@ -0,0 +1,149 @@
+/*
+console NBP currency converter
+
+MIT License
+
+Copyright (c) 2021 Kajetan Welc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+Rendered tables kept by the query that made them, so a repeated command only
+costs a lookup. The entries belong to one snapshot version: the first lookup
+with another version drops all of them. The least recently used entries are
+dropped once the keys and texts take more than the capacity.
+*/
+
+#ifndef RENDERED_TABLE_CACHE_H
+#define RENDERED_TABLE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+
+std::size_t const RENDERED_TABLE_CACHE_BYTES          = 1024 * 1024;
+std::size_t const RENDERED_TABLE_CACHE_ENTRY_OVERHEAD = 128;
+
+
+struct rendered_table_cache {
+  private:
+    struct entry {
+        std::string key;
+        std::string text;
+    };
+
+    std::size_t capacity_bytes;
+    std::size_t bytes     = 0;
+    std::uint64_t version = 0;
+
+    // most recently used first; the index keys view the keys of the list,
+    // whose nodes never move
+    std::list<entry> entries;
+    std::unordered_map<std::string_view, std::list<entry>::iterator> index;
+
+    static auto entry_bytes(entry const& e) -> std::size_t
+    {
+        return e.key.size() + e.text.size()
+               + RENDERED_TABLE_CACHE_ENTRY_OVERHEAD;
+    }
+
+    auto use_version(std::uint64_t const snapshot_version) -> void
+    {
+        if (snapshot_version != version) {
+            clear();
+            version = snapshot_version;
+        }
+    }
+
+  public:
+    explicit rendered_table_cache(
+        std::size_t const capacity = RENDERED_TABLE_CACHE_BYTES)
+        : capacity_bytes{capacity}
+    {
+    }
+
+    // nullptr if the table of the query has not been rendered for the version
+    auto find(std::uint64_t const snapshot_version, std::string const& key)
+        -> std::string const*
+    {
+        use_version(snapshot_version);
+
+        auto const it = index.find(key);
+        if (it == index.end()) {
+            return nullptr;
+        }
+
+        entries.splice(entries.begin(), entries, it->second);
+        return &it->second->text;
+    }
+
+    // A text that alone exceeds the capacity is not kept.
+    auto insert(std::uint64_t const snapshot_version,
+                std::string key,
+                std::string text) -> void
+    {
+        use_version(snapshot_version);
+
+        auto const it = index.find(key);
+        if (it != index.end()) {
+            bytes -= entry_bytes(*it->second);
+            entries.erase(it->second);
+            index.erase(it);
+        }
+
+        auto e = entry{std::move(key), std::move(text)};
+        if (entry_bytes(e) > capacity_bytes) {
+            return;
+        }
+
+        bytes += entry_bytes(e);
+        entries.push_front(std::move(e));
+        index.emplace(entries.front().key, entries.begin());
+
+        while (bytes > capacity_bytes) {
+            bytes -= entry_bytes(entries.back());
+            index.erase(entries.back().key);
+            entries.pop_back();
+        }
+    }
+
+    auto clear() -> void
+    {
+        index.clear();
+        entries.clear();
+        bytes = 0;
+    }
+
+    auto size() const -> std::size_t
+    {
+        return entries.size();
+    }
+
+    auto footprint_bytes() const -> std::size_t
+    {
+        return bytes;
+    }
+};
+
+#endif
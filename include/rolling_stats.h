@@ -0,0 +1,178 @@
+/*
+console NBP currency converter
+
+MIT License
+
+Copyright (c) 2021 Kajetan Welc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+Moving averages and volatilities of the rates over the last tables, updated in
+constant time whenever a new table is applied.
+*/
+
+#ifndef ROLLING_STATS_H
+#define ROLLING_STATS_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+
+int const ROLLING_STATS_WINDOWS_COUNT                           = 2;
+int const ROLLING_STATS_WINDOW_DAYS[ROLLING_STATS_WINDOWS_COUNT] = {30, 90};
+
+
+// Sum and sum of squares of the last values pushed. Each push adds the new
+// value and subtracts the one that falls out of the window; the sums are
+// rebuilt from the ring once per window length, so rounding errors do not
+// pile up and a push still costs O(1) amortized.
+struct rolling_window {
+  private:
+    std::vector<double> values;
+    int next_index           = 0;
+    int count                = 0;
+    int pushes_since_rebuild = 0;
+
+    // the sums are taken relative to the first value, like in range_stats
+    double shift  = 0;
+    double sum    = 0;
+    double sum_sq = 0;
+
+    auto rebuild() -> void
+    {
+        sum    = 0;
+        sum_sq = 0;
+        for (auto i = 0; i < count; i++) {
+            auto const diff = values[i] - shift;
+            sum += diff;
+            sum_sq += diff * diff;
+        }
+        pushes_since_rebuild = 0;
+    }
+
+  public:
+    explicit rolling_window(int const length) : values(std::max(length, 1))
+    {
+    }
+
+    auto push(double const value) -> void
+    {
+        if (!count) {
+            shift = value;
+        }
+
+        if (count == (int)values.size()) {
+            auto const diff = values[next_index] - shift;
+            sum -= diff;
+            sum_sq -= diff * diff;
+        } else {
+            count++;
+        }
+
+        auto const diff    = value - shift;
+        values[next_index] = value;
+        next_index         = (next_index + 1) % (int)values.size();
+        sum += diff;
+        sum_sq += diff * diff;
+
+        if (++pushes_since_rebuild == (int)values.size()) {
+            rebuild();
+        }
+    }
+
+    auto size() const -> int
+    {
+        return count;
+    }
+
+    auto mean() const -> double
+    {
+        return count ? shift + sum / count : 0;
+    }
+
+    auto stddev() const -> double
+    {
+        if (!count) {
+            return 0;
+        }
+
+        auto const mean_diff = sum / count;
+        return std::sqrt(std::max(0.0, sum_sq / count - mean_diff * mean_diff));
+    }
+};
+
+
+struct rolling_stats {
+    // number of tables in the window, smaller than its length at first
+    int days = 0;
+
+    double mean = 0;
+
+    // standard deviation of the daily log returns, not annualized
+    double volatility = 0;
+};
+
+
+// The rolling statistics of one currency for every window length.
+struct currency_rolling_stats {
+  private:
+    std::vector<rolling_window> rates;
+    std::vector<rolling_window> returns;
+    double previous_rate = 0;
+
+  public:
+    currency_rolling_stats()
+    {
+        for (auto const& days : ROLLING_STATS_WINDOW_DAYS) {
+            rates.emplace_back(days);
+
+            // n rates of a window make n - 1 returns
+            returns.emplace_back(days - 1);
+        }
+    }
+
+    auto push(double const rate) -> void
+    {
+        auto const has_return = rates.front().size() && previous_rate > 0
+                                && rate > 0;
+
+        for (auto i = 0; i < ROLLING_STATS_WINDOWS_COUNT; i++) {
+            rates[i].push(rate);
+            if (has_return) {
+                returns[i].push(std::log(rate / previous_rate));
+            }
+        }
+
+        previous_rate = rate;
+    }
+
+    auto stats(int const window_index) const -> rolling_stats
+    {
+        auto result       = rolling_stats{};
+        result.days       = rates[window_index].size();
+        result.mean       = rates[window_index].mean();
+        result.volatility = returns[window_index].stddev();
+
+        return result;
+    }
+};
+
+#endif
@@ -0,0 +1,556 @@
+/*
+console NBP currency converter
+
+MIT License
+
+Copyright (c) 2021 Kajetan Welc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+Layout of the exchange rate snapshot published by the currency converter into
+a POSIX shared memory segment, with the writer of the converter and a reader
+that other processes on the same host can include on its own.
+
+The segment is guarded by a seqlock: the writer makes the sequence odd, writes
+the snapshot and makes it even again. A reader retries whenever it sees an odd
+sequence or the sequence changed while it was reading, so once the segment is
+mapped a conversion takes no syscalls and no locks. Writers take turns through
+the pid stored in the segment; the lock of a writer that died while publishing
+is taken over by the next one, and readers give up after a bounded number of
+retries instead of waiting for it. Only the writer that creates the segment
+sets its version; the others wait for it, and leave a segment of another
+version alone.
+
+The snapshot also carries the rolling means and volatilities of the rates, so a
+dashboard can read them without asking the converter.
+*/
+
+#ifndef SHARED_RATES_H
+#define SHARED_RATES_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#if defined(__APPLE__) || defined(__unix__) || defined(__unix)
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+// the default name, NBP_CONVERTER_SHARED_RATES_NAME sets another one
+char const SHARED_RATES_NAME[]           = "/nbp_currency_converter_rates";
+int const SHARED_RATES_MAX_CURRENCIES    = 256;
+int const SHARED_RATES_CODE_SIZE         = 4;
+int const SHARED_RATES_DATE_SIZE         = 16;
+int const SHARED_RATES_ROLLING_WINDOWS   = 2;
+std::uint32_t const SHARED_RATES_VERSION = 3;
+
+// tries of a reader or a writer, each after yielding the processor; a publish
+// takes well under a millisecond
+int const SHARED_RATES_READ_ATTEMPTS = 10000;
+int const SHARED_RATES_LOCK_ATTEMPTS = 10000;
+
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free,
+              "the seqlock must be lock-free to live in shared memory");
+static_assert(std::atomic<std::int32_t>::is_always_lock_free,
+              "the writer lock must be lock-free to live in shared memory");
+
+
+inline auto shared_rates_name() -> std::string
+{
+    auto const* const name = std::getenv("NBP_CONVERTER_SHARED_RATES_NAME");
+    return name ? name : SHARED_RATES_NAME;
+}
+
+
+// rates of the currency in PLN over the last tables of one window
+struct shared_rolling_stats {
+    // tables in the window so far
+    std::uint32_t days;
+    float mean;
+
+    // standard deviation of the daily log returns
+    float volatility;
+};
+
+
+struct shared_rates_segment {
+    // set once by the writer that created the segment, 0 until then
+    std::atomic<std::uint32_t> version;
+    std::atomic<std::uint32_t> sequence;
+
+    // pid of the process publishing now, 0 if none
+    std::atomic<std::int32_t> writer_pid;
+
+    std::uint32_t currencies_count;
+    char publication_date[SHARED_RATES_DATE_SIZE];
+    char codes[SHARED_RATES_MAX_CURRENCIES][SHARED_RATES_CODE_SIZE];
+
+    // value of one unit of the currency in PLN
+    float rates[SHARED_RATES_MAX_CURRENCIES];
+
+    // cross_rates[i][j] is the value of one unit of currency i in currency j
+    float cross_rates[SHARED_RATES_MAX_CURRENCIES][SHARED_RATES_MAX_CURRENCIES];
+
+    // length in tables of each rolling window
+    std::uint32_t rolling_window_days[SHARED_RATES_ROLLING_WINDOWS];
+    shared_rolling_stats rolling[SHARED_RATES_MAX_CURRENCIES]
+                                [SHARED_RATES_ROLLING_WINDOWS];
+};
+
+
+#if defined(__APPLE__) || defined(__unix__) || defined(__unix)
+// a process this user may not signal is still running
+inline auto shared_rates_writer_alive(std::int32_t const pid) -> bool
+{
+    return kill(pid, 0) == 0 || errno == EPERM;
+}
+
+
+// Takes the writer lock of the segment and makes the sequence odd. The lock of
+// a writer that is no longer running is taken over, and the sequence it left
+// odd is kept odd. Returns false if another writer holds the lock for too long.
+inline auto shared_rates_lock(shared_rates_segment& segment) -> bool
+{
+    auto const pid = (std::int32_t)getpid();
+
+    for (auto i = 0; i < SHARED_RATES_LOCK_ATTEMPTS; i++) {
+        auto owner = segment.writer_pid.load(std::memory_order_relaxed);
+
+        if ((owner == 0 || !shared_rates_writer_alive(owner))
+            && segment.writer_pid.compare_exchange_strong(
+                owner, pid, std::memory_order_acquire)) {
+            auto const sequence =
+                segment.sequence.load(std::memory_order_relaxed);
+            if (!(sequence & 1)) {
+                segment.sequence.store(sequence + 1,
+                                       std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_release);
+
+            return true;
+        }
+
+        std::this_thread::yield();
+    }
+
+    return false;
+}
+
+
+inline auto shared_rates_unlock(shared_rates_segment& segment) -> void
+{
+    segment.sequence.fetch_add(1, std::memory_order_release);
+    segment.writer_pid.store(0, std::memory_order_release);
+}
+
+
+// the segment behind fd is large enough to be mapped
+inline auto shared_rates_sized(int const fd) -> bool
+{
+    struct stat status;
+    return fstat(fd, &status) == 0
+           && status.st_size >= (off_t)sizeof(shared_rates_segment);
+}
+
+
+// Retries ready until it holds, e.g. until the writer that created the segment
+// has sized it. Returns false if it never does.
+template<typename Ready>
+inline auto shared_rates_wait(Ready&& ready) -> bool
+{
+    for (auto i = 0; i < SHARED_RATES_LOCK_ATTEMPTS; i++) {
+        if (ready()) {
+            return true;
+        }
+
+        std::this_thread::yield();
+    }
+
+    return false;
+}
+#endif
+
+
+// what a writer publishes of one currency
+struct shared_rate_entry {
+    std::string_view code;
+    float rate = 0;
+    shared_rolling_stats rolling[SHARED_RATES_ROLLING_WINDOWS] = {};
+};
+
+
+struct shared_rates_writer {
+  private:
+    shared_rates_segment* segment = nullptr;
+
+    auto open() -> bool
+    {
+#if defined(__APPLE__) || defined(__unix__) || defined(__unix)
+        if (segment) {
+            return true;
+        }
+
+        auto const name = shared_rates_name();
+
+        // Only the writer whose O_EXCL open creates the segment sets it up.
+        // ftruncate() zeroes it, which frees the lock and makes the sequence
+        // even.
+        auto created = bool{true};
+        auto fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (fd == -1 && errno == EEXIST) {
+            created = false;
+            fd      = shm_open(name.c_str(), O_RDWR, 0);
+        }
+        if (fd == -1) {
+            return false;
+        }
+
+        if (created && ftruncate(fd, sizeof(shared_rates_segment)) == -1) {
+            ::close(fd);
+            shm_unlink(name.c_str());
+            return false;
+        }
+
+        if (!created
+            && !shared_rates_wait([fd] { return shared_rates_sized(fd); })) {
+            ::close(fd);
+            return false;
+        }
+
+        auto* const mapping = mmap(nullptr,
+                                   sizeof(shared_rates_segment),
+                                   PROT_READ | PROT_WRITE,
+                                   MAP_SHARED,
+                                   fd,
+                                   0);
+        ::close(fd);
+
+        if (mapping == MAP_FAILED) {
+            return false;
+        }
+
+        auto* const opened = static_cast<shared_rates_segment*>(mapping);
+        if (created) {
+            opened->version.store(SHARED_RATES_VERSION,
+                                  std::memory_order_release);
+        } else if (!shared_rates_wait([opened] {
+                       return opened->version.load(std::memory_order_acquire)
+                              == SHARED_RATES_VERSION;
+                   })) {
+            // the lock words of another layout mean something else
+            munmap(opened, sizeof(shared_rates_segment));
+            return false;
+        }
+
+        segment = opened;
+        return true;
+#else
+        return false;
+#endif
+    }
+
+  public:
+    shared_rates_writer() = default;
+    shared_rates_writer(shared_rates_writer const&) = delete;
+    auto operator=(shared_rates_writer const&) -> shared_rates_writer& = delete;
+
+    ~shared_rates_writer()
+    {
+#if defined(__APPLE__) || defined(__unix__) || defined(__unix)
+        if (segment) {
+            munmap(segment, sizeof(shared_rates_segment));
+        }
+#endif
+    }
+
+    // Publishing is best-effort: readers on the host simply keep seeing the
+    // previous snapshot if the segment cannot be opened or another writer
+    // keeps it locked. The rates past SHARED_RATES_MAX_CURRENCIES are left
+    // out, window_days holds the length of every rolling window.
+    auto publish(std::string_view const publication_date,
+                 std::vector<shared_rate_entry> const& rates,
+                 std::vector<int> const& window_days) -> bool
+    {
+#if defined(__APPLE__) || defined(__unix__) || defined(__unix)
+        // several converters on one host may publish
+        if (!open() || !shared_rates_lock(*segment)) {
+            return false;
+        }
+
+        auto const count =
+            std::min((int)rates.size(), SHARED_RATES_MAX_CURRENCIES);
+        for (auto i = 0; i < count; i++) {
+            std::memset(segment->codes[i], 0, SHARED_RATES_CODE_SIZE);
+            std::memcpy(segment->codes[i],
+                        rates[i].code.data(),
+                        std::min((int)rates[i].code.size(),
+                                 SHARED_RATES_CODE_SIZE - 1));
+            segment->rates[i] = rates[i].rate;
+
+            std::copy(std::begin(rates[i].rolling),
+                      std::end(rates[i].rolling),
+                      segment->rolling[i]);
+        }
+
+        for (auto i = 0; i < count; i++) {
+            for (auto j = 0; j < count; j++) {
+                segment->cross_rates[i][j] =
+                    segment->rates[i] / segment->rates[j];
+            }
+        }
+
+        segment->currencies_count = count;
+
+        for (auto i = 0; i < SHARED_RATES_ROLLING_WINDOWS; i++) {
+            segment->rolling_window_days[i] =
+                i < (int)window_days.size() ? window_days[i] : 0;
+        }
+
+        std::memset(segment->publication_date, 0, SHARED_RATES_DATE_SIZE);
+        std::memcpy(segment->publication_date,
+                    publication_date.data(),
+                    std::min((int)publication_date.size(),
+                             SHARED_RATES_DATE_SIZE - 1));
+
+        shared_rates_unlock(*segment);
+        return true;
+#else
+        (void)publication_date;
+        (void)rates;
+        (void)window_days;
+        return false;
+#endif
+    }
+};
+
+
+struct shared_rates_reader {
+  private:
+    shared_rates_segment const* segment = nullptr;
+
+    // Calls read until it ran while no writer touched the segment. Returns
+    // false if the segment stays locked, e.g. by a writer that died while
+    // publishing and has not been replaced yet.
+    template<typename Read>
+    auto read_consistent(Read&& read) const -> bool
+    {
+        for (auto i = 0; i < SHARED_RATES_READ_ATTEMPTS; i++) {
+            auto const sequence_before =
+                segment->sequence.load(std::memory_order_acquire);
+
+            if (!(sequence_before & 1)) {
+                read();
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (segment->sequence.load(std::memory_order_relaxed)
+                    == sequence_before) {
+                    return true;
+                }
+            }
+
+            std::this_thread::yield();
+        }
+
+        return false;
+    }
+
+    auto find_code(std::string const& code) const -> int
+    {
+        if (code.size() >= (std::size_t)SHARED_RATES_CODE_SIZE) {
+            return -1;
+        }
+
+        char key[SHARED_RATES_CODE_SIZE] = {};
+        std::memcpy(key, code.data(), code.size());
+
+        auto const count = (int)segment->currencies_count;
+        for (auto i = 0; i < count && i < SHARED_RATES_MAX_CURRENCIES; i++) {
+            if (!std::memcmp(segment->codes[i], key, SHARED_RATES_CODE_SIZE)) {
+                return i;
+            }
+        }
+
+        return -1;
+    }
+
+  public:
+    shared_rates_reader() = default;
+    shared_rates_reader(shared_rates_reader const&) = delete;
+    auto operator=(shared_rates_reader const&) -> shared_rates_reader& = delete;
+
+    ~shared_rates_reader()
+    {
+        close();
+    }
+
+    auto open(std::string const& name = shared_rates_name()) -> bool
+    {
+#if defined(__APPLE__) || defined(__unix__) || defined(__unix)
+        close();
+
+        auto const fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd == -1) {
+            return false;
+        }
+
+        // a segment the writer has not sized yet
+        if (!shared_rates_sized(fd)) {
+            ::close(fd);
+            return false;
+        }
+
+        auto* const mapping = mmap(nullptr,
+                                   sizeof(shared_rates_segment),
+                                   PROT_READ,
+                                   MAP_SHARED,
+                                   fd,
+                                   0);
+        ::close(fd);
+
+        if (mapping == MAP_FAILED) {
+            return false;
+        }
+
+        segment = static_cast<shared_rates_segment const*>(mapping);
+        if (segment->version.load(std::memory_order_acquire)
+            != SHARED_RATES_VERSION) {
+            close();
+            return false;
+        }
+
+        return true;
+#else
+        (void)name;
+        return false;
+#endif
+    }
+
+    auto close() -> void
+    {
+#if defined(__APPLE__) || defined(__unix__) || defined(__unix)
+        if (segment) {
+            munmap(const_cast<shared_rates_segment*>(segment),
+                   sizeof(shared_rates_segment));
+        }
+#endif
+        segment = nullptr;
+    }
+
+    auto is_open() const -> bool
+    {
+        return segment != nullptr;
+    }
+
+    // Returns false if the segment is not mapped or stays locked, or if a
+    // currency is unknown.
+    auto convert(float const& input_value,
+                 std::string const& input_currency,
+                 std::string const& target_currency,
+                 float& result) const -> bool
+    {
+        if (!segment) {
+            return false;
+        }
+
+        auto input_index  = -1;
+        auto target_index = -1;
+        auto cross_rate   = float{0};
+
+        auto const is_read = read_consistent([&] {
+            input_index  = find_code(input_currency);
+            target_index = find_code(target_currency);
+            if (input_index != -1 && target_index != -1) {
+                cross_rate = segment->cross_rates[input_index][target_index];
+            }
+        });
+
+        if (!is_read || input_index == -1 || target_index == -1) {
+            return false;
+        }
+
+        result = input_value * cross_rate;
+        return true;
+    }
+
+    // Returns false if the segment is not mapped or stays locked, the
+    // currency is unknown or no window is window_days long.
+    auto rolling(std::string const& code,
+                 int const window_days,
+                 shared_rolling_stats& result) const -> bool
+    {
+        if (!segment) {
+            return false;
+        }
+
+        auto index        = -1;
+        auto window_index = -1;
+
+        auto const is_read = read_consistent([&] {
+            index        = find_code(code);
+            window_index = -1;
+            for (auto i = 0; i < SHARED_RATES_ROLLING_WINDOWS; i++) {
+                if (segment->rolling_window_days[i]
+                    == (std::uint32_t)window_days) {
+                    window_index = i;
+                }
+            }
+            if (index != -1 && window_index != -1) {
+                result = segment->rolling[index][window_index];
+            }
+        });
+
+        return is_read && index != -1 && window_index != -1;
+    }
+
+    // empty if the segment is not mapped or stays locked
+    auto publication_date() const -> std::string
+    {
+        if (!segment) {
+            return "";
+        }
+
+        char date[SHARED_RATES_DATE_SIZE];
+        auto const is_read = read_consistent([&] {
+            std::memcpy(date, segment->publication_date, sizeof(date));
+        });
+
+        if (!is_read) {
+            return "";
+        }
+
+        date[SHARED_RATES_DATE_SIZE - 1] = '\0';
+        return date;
+    }
+};
+
+#endif
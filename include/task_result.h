@@ -0,0 +1,69 @@
+/*
+console NBP currency converter
+
+MIT License
+
+Copyright (c) 2021 Kajetan Welc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+/*
+Value of a task that runs on its own thread, or the reason it has none. Each
+task fills its own result, so the tasks share no state and their errors are
+collected by whoever joins them.
+*/
+
+#ifndef TASK_RESULT_H
+#define TASK_RESULT_H
+
+#include <string>
+#include <utility>
+
+
+template<typename T>
+struct task_result {
+    T value{};
+
+    // empty if the task has succeeded
+    std::string error;
+
+    auto ok() const -> bool
+    {
+        return error.empty();
+    }
+
+    static auto success(T value) -> task_result
+    {
+        auto result  = task_result{};
+        result.value = std::move(value);
+
+        return result;
+    }
+
+    static auto failure(std::string error) -> task_result
+    {
+        auto result  = task_result{};
+        result.error = std::move(error);
+
+        return result;
+    }
+};
+
+#endif
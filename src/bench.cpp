@@ -0,0 +1,578 @@
+/*
+console NBP currency converter
+
+MIT License
+
+Copyright (c) 2021 Kajetan Welc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+Microbenchmarks of the currency converter hot paths.
+
+  bench.bin [RECORDINGS_DIR] [BENCHMARK_NAME_FILTER]
+
+Every benchmark prints one JSON line with its ns/op and allocations/op, so the
+outputs of two builds can be diffed directly. Only allocations made through
+operator new are counted; libfort allocates with malloc and does not show up.
+*/
+
+#include <currency_converter.h>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+
+
+std::atomic<long long> allocations_count{0};
+
+// The replaced operators are a matching pair, but once operator new is
+// inlined at -O2 GCC only sees the std::malloc behind it and reports the
+// std::free of every delete as -Wmismatched-new-delete.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+auto operator new(std::size_t size) -> void*
+{
+    allocations_count.fetch_add(1, std::memory_order_relaxed);
+
+    if (auto* const ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+
+auto operator new[](std::size_t size) -> void*
+{
+    return operator new(size);
+}
+
+auto operator delete(void* ptr) noexcept -> void
+{
+    std::free(ptr);
+}
+
+auto operator delete[](void* ptr) noexcept -> void
+{
+    std::free(ptr);
+}
+
+auto operator delete(void* ptr, std::size_t) noexcept -> void
+{
+    std::free(ptr);
+}
+
+auto operator delete[](void* ptr, std::size_t) noexcept -> void
+{
+    std::free(ptr);
+}
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+
+template<typename T>
+auto do_not_optimize(T const& value) -> void
+{
+#if defined(__GNUC__)
+    asm volatile("" : : "g"(&value) : "memory");
+#else
+    static void const* volatile sink;
+    sink = &value;
+#endif
+}
+
+
+struct currency_converter_bench {
+  private:
+    long long const MIN_BENCHMARK_NS = 200 * 1000 * 1000;
+
+    std::string filter;
+    std::ostream results;
+    std::string nbp_payload;
+    std::string table_b_payload;
+    std::string bid_ask_payload;
+    std::string names_payload;
+
+    struct null_buffer : std::streambuf {
+        auto overflow(int c) -> int override
+        {
+            return c;
+        }
+    };
+
+    // exposes the table parser that the rate providers share
+    struct nbp_parser : rate_provider {
+        using rate_provider::parse_nbp_json;
+
+        auto name() const -> std::string override
+        {
+            return "bench";
+        }
+
+        auto fetch(std::atomic<bool> const&) -> rate_provider_result override
+        {
+            return {};
+        }
+    };
+
+    static auto read_file(std::string const& file_path) -> std::string
+    {
+        std::ifstream file{file_path, std::ios::binary};
+        if (!file) {
+            std::cerr << "Cannot read " << file_path << "\n";
+            std::exit(1);
+        }
+
+        std::stringstream tmp_ss;
+        tmp_ss << file.rdbuf();
+
+        return tmp_ss.str();
+    }
+
+    // Doubles the iteration count until one batch runs long enough, then
+    // reports that batch.
+    template<typename F>
+    auto run(std::string const& name, F&& f) -> void
+    {
+        if (!filter.empty() && name.find(filter) == std::string::npos) {
+            return;
+        }
+
+        auto iterations = (long long)1;
+        while (true) {
+            auto const allocations_before = allocations_count.load();
+            auto const start              = std::chrono::steady_clock::now();
+
+            for (auto i = (long long)0; i < iterations; i++) {
+                f();
+            }
+
+            auto const elapsed_ns =
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+            auto const allocations =
+                allocations_count.load() - allocations_before;
+
+            if (elapsed_ns < MIN_BENCHMARK_NS) {
+                iterations *= 2;
+                continue;
+            }
+
+            auto const result = nlohmann::ordered_json{
+                {"benchmark", name},
+                {"iterations", iterations},
+                {"ns_per_op", (double)elapsed_ns / iterations},
+                {"allocs_per_op", (double)allocations / iterations}};
+
+            results << result.dump() << std::endl;
+            return;
+        }
+    }
+
+    // The recorded table A and B rates, the smallest ones included, have to
+    // come back from the history with every quoted digit. Exits if one does
+    // not.
+    auto run_history_round_trip() -> void
+    {
+        auto smallest   = std::string{};
+        auto min_rate   = double{0};
+        auto mismatches = int{0};
+        auto count      = int{0};
+
+        for (auto const* payload : {&nbp_payload, &table_b_payload}) {
+            auto const table = nbp_parser::parse_nbp_json(*payload).table;
+
+            auto history = rate_history{};
+            history.append(table.publication_date, table.rates);
+
+            auto const tables = json::parse(*payload);
+            for (auto const& rate : tables[0]["rates"]) {
+                auto const code   = rate["code"].get<std::string>();
+                auto const quoted = rate["mid"].get<double>();
+                auto const stored = rate_history::from_fixed_point(
+                    history.column(code)->last());
+
+                if (std::abs(stored - quoted) > quoted * 1e-9) {
+                    std::cerr << "history round trip: " << code << " "
+                              << quoted << " became " << stored << "\n";
+                    mismatches++;
+                }
+
+                if (smallest.empty() || quoted < min_rate) {
+                    smallest = code;
+                    min_rate = quoted;
+                }
+                count++;
+            }
+        }
+
+        auto const result = nlohmann::ordered_json{
+            {"benchmark", "history_round_trip"},
+            {"rates", count},
+            {"smallest", smallest},
+            {"smallest_rate", min_rate},
+            {"mismatches", mismatches}};
+        results << result.dump() << std::endl;
+
+        if (mismatches) {
+            std::exit(1);
+        }
+    }
+
+    // The core has to draw every table exactly as libfort does, or hand it
+    // back to be drawn by libfort. Exits if a drawn table differs.
+    auto run_render_check(currency_converter& cc) -> void
+    {
+        // Cyrillic and Greek names have a known width, the Japanese one
+        // makes every table with JPY fall back to libfort
+        cc.core.set_currency_names("XX",
+                                   {{"EUR", "Евро"},
+                                    {"USD", "Δολάριο ΗΠΑ"},
+                                    {"JPY", "日本円"}});
+        auto const rates = cc.core.snapshot();
+
+        auto variants   = int{0};
+        auto fallbacks  = int{0};
+        auto mismatches = int{0};
+
+        for (auto const* const language : {"", "PL", "EN", "XX"}) {
+            for (auto const* const base : {"PLN", "USD"}) {
+                for (auto const& targets :
+                     {std::vector<std::string>{},
+                      std::vector<std::string>{"EUR", "USD", "GBP"},
+                      std::vector<std::string>{"EUR", "JPY"}}) {
+                    auto rendered = std::string{};
+                    variants++;
+                    if (!cc.core.render_table(*rates,
+                                              base,
+                                              targets,
+                                              language,
+                                              cc.DEFAULT_DECIMAL_POINTS_NUMBER,
+                                              rendered)) {
+                        fallbacks++;
+                        continue;
+                    }
+
+                    auto const expected =
+                        cc.make_currency_table(*rates, base, targets, language)
+                            .to_string();
+                    if (rendered != expected) {
+                        std::cerr << "render_table differs from libfort for "
+                                  << base << " in \"" << language << "\"\n"
+                                  << rendered << "\n"
+                                  << expected << "\n";
+                        mismatches++;
+                    }
+                }
+            }
+        }
+
+        auto const result =
+            nlohmann::ordered_json{{"benchmark", "render_table_check"},
+                                   {"variants", variants},
+                                   {"fallbacks", fallbacks},
+                                   {"mismatches", mismatches}};
+        results << result.dump() << std::endl;
+
+        if (mismatches) {
+            std::exit(1);
+        }
+    }
+
+    // 20 years of 4 decimal random walks starting at the recorded rates,
+    // stored packed and as plain float columns
+    auto run_history(rate_table const& table) -> void
+    {
+        auto const days_count = 20 * 250;
+
+        auto history = rate_history{};
+        std::map<std::string, std::vector<float>> raw_columns;
+
+        auto generator  = std::mt19937{42};
+        auto daily_move = std::normal_distribution<double>{0, 0.003};
+
+        auto rates = table.rates;
+        for (auto i = 0; i < days_count; i++) {
+            for (auto& each : rates) {
+                each.rate =
+                    std::round(each.rate * (1 + daily_move(generator)) * 10000)
+                    / 10000;
+                raw_columns[each.code].push_back(each.rate);
+            }
+
+            history.append(days_to_date(date_to_days("2001-01-01") + i),
+                           rates);
+        }
+
+        auto raw_bytes = std::size_t{0};
+        for (auto const& [code, column] : raw_columns) {
+            raw_bytes += column.size() * sizeof(float);
+        }
+
+        auto const footprint = nlohmann::ordered_json{
+            {"benchmark", "history_footprint"},
+            {"days", days_count},
+            {"currencies", raw_columns.size()},
+            {"raw_bytes", raw_bytes},
+            {"packed_bytes", history.footprint_bytes()},
+            {"ratio", (double)raw_bytes / history.footprint_bytes()}};
+        results << footprint.dump() << std::endl;
+
+        run("history_scan_packed", [&] {
+            auto sum = std::int64_t{0};
+            history.for_each_block(
+                "EUR",
+                0,
+                days_count,
+                [&](std::int64_t const* values, int const count, int) {
+                    auto block_sum = std::int64_t{0};
+                    for (auto i = 0; i < count; i++) {
+                        block_sum += values[i];
+                    }
+                    sum += block_sum;
+                });
+            do_not_optimize(sum);
+        });
+
+        auto const& raw_eur = raw_columns["EUR"];
+        run("history_scan_raw", [&] {
+            auto sum = double{0};
+            for (auto const& each : raw_eur) {
+                sum += each;
+            }
+            do_not_optimize(sum);
+        });
+
+        run("history_range_stats", [&] {
+            do_not_optimize(
+                compute_range_stats(history, "EUR", "PLN", 0, days_count));
+        });
+
+        run("history_range_stats_cross", [&] {
+            do_not_optimize(
+                compute_range_stats(history, "EUR", "USD", 0, days_count));
+        });
+    }
+
+  public:
+    currency_converter_bench(std::string const& recordings_dir, std::string f)
+        : filter{std::move(f)}
+        , results{std::cout.rdbuf()}
+    {
+        nbp_payload =
+            read_file(recordings_dir + "/api_exchangerates_tables_a");
+        table_b_payload =
+            read_file(recordings_dir + "/api_exchangerates_tables_b");
+        bid_ask_payload =
+            read_file(recordings_dir + "/api_exchangerates_tables_c");
+        names_payload = read_file(recordings_dir + "/api_currencies.json");
+    }
+
+    auto run_all() -> void
+    {
+        auto const table = nbp_parser::parse_nbp_json(nbp_payload).table;
+        auto cc          = currency_converter{table};
+        auto names = std::vector<std::pair<std::string, std::string>>{};
+        auto const names_json = json::parse(names_payload);
+        for (auto const& [code, name] : names_json.items()) {
+            names.emplace_back(code, name.get<std::string>());
+        }
+        cc.core.set_currency_names("EN", names);
+
+        run("parse_json", [&] {
+            do_not_optimize(cc.parse_json(nbp_payload));
+        });
+
+        run("parse_nbp_json", [&] {
+            do_not_optimize(nbp_parser::parse_nbp_json(nbp_payload));
+        });
+
+        // the same table read back from disk, raw and gzip compressed
+        auto const table_path = std::filesystem::temp_directory_path()
+                                / "nbp_converter_bench_table";
+        std::ofstream{table_path.string() + ".json"} << nbp_payload;
+        write_gzip_file(table_path.string() + ".json.gz", nbp_payload);
+
+        for (auto const& extension : {".json", ".json.gz"}) {
+            auto provider =
+                local_file_provider{table_path.string() + extension, 0};
+            auto const not_cancelled = std::atomic<bool>{false};
+
+            run(std::string{"local_file_provider"} + extension, [&] {
+                do_not_optimize(provider.fetch(not_cancelled));
+            });
+
+            std::filesystem::remove(table_path.string() + extension);
+        }
+
+        run_history_round_trip();
+        run_history(table);
+
+        run("core_load", [&] {
+            cc.core.load(table);
+        });
+
+        auto const rates = cc.core.snapshot();
+        run("convert_currency", [&] {
+            do_not_optimize(rates->convert(10, "EUR", "USD"));
+        });
+
+        auto const bid_ask_rates =
+            nbp_parser::parse_nbp_json(bid_ask_payload).table.bid_ask_rates;
+        run("bid_ask_routes_build", [&] {
+            do_not_optimize(bid_ask_routes::from_bid_ask_rates(bid_ask_rates));
+        });
+
+        auto const routes = bid_ask_routes::from_bid_ask_rates(bid_ask_rates);
+        run("convert_bid_ask", [&] {
+            auto result = double{0};
+            do_not_optimize(routes.convert(10, "EUR", "USD", result));
+            do_not_optimize(result);
+        });
+
+        run("string_to_vector", [&] {
+            do_not_optimize(cc.string_to_vector("10 EUR 99 RUB TO USD"));
+        });
+
+        run("float_to_fixed_to_string", [&] {
+            do_not_optimize(cc.float_to_fixed_to_string(
+                12.101896f, cc.DEFAULT_DECIMAL_POINTS_NUMBER));
+        });
+
+        run_render_check(cc);
+
+        auto const all = std::vector<std::string>{};
+
+        run("make_currency_table", [&] {
+            do_not_optimize(cc.make_currency_table(*rates, "PLN", all, ""));
+        });
+
+        run("make_currency_table_names", [&] {
+            do_not_optimize(cc.make_currency_table(*rates, "PLN", all, "EN"));
+        });
+
+        auto const names_table =
+            cc.make_currency_table(*rates, "PLN", all, "EN");
+        run("currency_table_to_string", [&] {
+            do_not_optimize(names_table.to_string());
+        });
+
+        // the same tables made and written without libfort, never cached
+        auto rendered = std::string{};
+        for (auto const& [name, language] :
+             {std::make_pair("render_currency_table", ""),
+              std::make_pair("render_currency_table_names", "EN")}) {
+            run(name, [&] {
+                {
+                    std::lock_guard<std::mutex> lck{cc.core.tables_mtx};
+                    cc.core.rendered_tables.clear();
+                }
+                do_not_optimize(cc.core.render_table(
+                    *rates,
+                    "PLN",
+                    all,
+                    language,
+                    cc.DEFAULT_DECIMAL_POINTS_NUMBER,
+                    rendered));
+            });
+        }
+
+        // the full cross rate grid of table A, written to nowhere
+        std::vector<std::string> all_currencies;
+        std::vector<double> all_rates;
+        for (auto const& rate : rates->rates()) {
+            all_currencies.push_back(rate.code);
+            all_rates.push_back(rate.rate);
+        }
+
+        auto null_matrix = null_buffer{};
+        auto matrix_out  = std::ostream{&null_matrix};
+
+        for (auto const& [name, format] :
+             {std::make_pair("csv", rate_matrix_format::csv),
+              std::make_pair("jsonl", rate_matrix_format::jsonl),
+              std::make_pair("table", rate_matrix_format::table)}) {
+            auto const writer =
+                rate_matrix_writer{all_currencies,
+                                   all_rates,
+                                   format,
+                                   cc.DEFAULT_DECIMAL_POINTS_NUMBER};
+
+            run(std::string{"rate_matrix_"} + name,
+                [&] { writer.write(matrix_out); });
+        }
+
+        auto const commands =
+            std::vector<std::pair<std::string, std::string>>{
+                {"read_command_line_date", "date"},
+                {"read_command_line_to", "10 eur 99 rub to usd"},
+                {"read_command_line_to_names", "10 eur to usd -n"},
+                {"read_command_line_table", "table pln"},
+                {"read_command_line_table_names", "table pln -n"}};
+
+        // the commands print, so their output is swallowed
+        auto null               = null_buffer{};
+        auto* const cout_buffer = std::cout.rdbuf(&null);
+
+        for (auto const& [name, line] : commands) {
+            run(name, [&] {
+                cc.read_command_line(line);
+            });
+        }
+
+        // an empty cache every time, so the table is rendered again
+        run("read_command_line_table_uncached", [&] {
+            {
+                std::lock_guard<std::mutex> lck{cc.core.tables_mtx};
+                cc.core.rendered_tables.clear();
+            }
+            cc.read_command_line("table pln");
+        });
+
+        std::cout.rdbuf(cout_buffer);
+    }
+};
+
+
+auto main(int argc, char* argv[]) -> int
+{
+    auto const recordings_dir =
+        std::string{argc > 1 ? argv[1] : "recordings"};
+    auto const filter = std::string{argc > 2 ? argv[2] : ""};
+
+    auto bench = currency_converter_bench{recordings_dir, filter};
+    bench.run_all();
+
+    return 0;
+}
@@ -0,0 +1,359 @@
+/*
+console NBP currency converter
+
+MIT License
+
+Copyright (c) 2021 Kajetan Welc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+The C interface of the library, see include/currency_converter_c.h. No
+exception leaves an entry point.
+*/
+
+#include <currency_converter_c.h>
+#include <currency_converter_core.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+struct ncc_snapshot {
+    std::atomic<int> references{1};
+    std::shared_ptr<rates_snapshot const> const rates;
+
+    explicit ncc_snapshot(std::shared_ptr<rates_snapshot const> r)
+        : rates{std::move(r)}
+    {
+    }
+};
+
+
+struct ncc_converter {
+    currency_converter_core core;
+
+    // the handle of the newest snapshot handed out, which keeps a reference
+    // of its own so that it is reused until a newer snapshot is published
+    ncc_snapshot* current = nullptr;
+    std::mutex mtx;
+};
+
+
+static auto to_ncc_status(converter_status const status) -> ncc_status
+{
+    switch (status) {
+    case converter_status::ok:
+        return NCC_OK;
+    case converter_status::unknown_currency:
+        return NCC_UNKNOWN_CURRENCY;
+    case converter_status::unknown_language:
+        return NCC_UNKNOWN_LANGUAGE;
+    }
+
+    return NCC_INVALID_ARGUMENT;
+}
+
+
+int ncc_abi_version(void)
+{
+    return NCC_ABI_VERSION;
+}
+
+
+ncc_converter* ncc_converter_new(void)
+{
+    try {
+        return new ncc_converter;
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+
+void ncc_converter_free(ncc_converter* converter)
+{
+    if (!converter) {
+        return;
+    }
+
+    ncc_snapshot_release(converter->current);
+    delete converter;
+}
+
+
+ncc_status ncc_converter_refresh(ncc_converter* converter)
+{
+    if (!converter) {
+        return NCC_INVALID_ARGUMENT;
+    }
+
+    try {
+        auto const result = converter->core.refresh();
+        if (!result.ok) {
+            return NCC_FETCH_FAILED;
+        }
+        converter->core.wait_pending_tables();
+
+        return result.stale ? NCC_STALE_RATES : NCC_OK;
+    } catch (std::bad_alloc const&) {
+        return NCC_OUT_OF_MEMORY;
+    } catch (...) {
+        return NCC_FETCH_FAILED;
+    }
+}
+
+
+ncc_status ncc_converter_set_currency_names(ncc_converter* converter,
+                                            char const* language_code,
+                                            char const* const* currency_codes,
+                                            char const* const* names,
+                                            size_t count)
+{
+    if (!converter || !language_code
+        || (count && (!currency_codes || !names))) {
+        return NCC_INVALID_ARGUMENT;
+    }
+
+    try {
+        std::vector<std::pair<std::string, std::string>> pairs;
+        for (auto i = size_t{0}; i < count; i++) {
+            if (!currency_codes[i] || !names[i]) {
+                return NCC_INVALID_ARGUMENT;
+            }
+            pairs.emplace_back(currency_codes[i], names[i]);
+        }
+
+        converter->core.set_currency_names(language_code, pairs);
+        return NCC_OK;
+    } catch (...) {
+        return NCC_OUT_OF_MEMORY;
+    }
+}
+
+
+ncc_snapshot* ncc_converter_snapshot(ncc_converter* converter)
+{
+    if (!converter) {
+        return nullptr;
+    }
+
+    auto rates = converter->core.snapshot();
+
+    std::unique_lock<std::mutex> lck{converter->mtx};
+
+    if (!converter->current || converter->current->rates != rates) {
+        auto* const next = new (std::nothrow) ncc_snapshot{std::move(rates)};
+        if (!next) {
+            return nullptr;
+        }
+
+        ncc_snapshot_release(converter->current);
+        converter->current = next;
+    }
+
+    ncc_snapshot_retain(converter->current);
+    return converter->current;
+}
+
+
+void ncc_snapshot_retain(ncc_snapshot* snapshot)
+{
+    if (snapshot) {
+        snapshot->references.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+
+void ncc_snapshot_release(ncc_snapshot* snapshot)
+{
+    if (snapshot
+        && snapshot->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete snapshot;
+    }
+}
+
+
+uint64_t ncc_snapshot_version(ncc_snapshot const* snapshot)
+{
+    return snapshot ? snapshot->rates->version() : 0;
+}
+
+
+char const* ncc_snapshot_publication_date(ncc_snapshot const* snapshot)
+{
+    return snapshot ? snapshot->rates->publication_date().c_str() : "";
+}
+
+
+size_t ncc_snapshot_rates_count(ncc_snapshot const* snapshot)
+{
+    return snapshot ? snapshot->rates->rates().size() : 0;
+}
+
+
+ncc_status ncc_convert(ncc_snapshot const* snapshot,
+                       float value,
+                       char const* from_code,
+                       char const* to_code,
+                       float* result)
+{
+    if (!snapshot || !from_code || !to_code || !result) {
+        return NCC_INVALID_ARGUMENT;
+    }
+
+    auto const converted = snapshot->rates->convert(value, from_code, to_code);
+    if (converted.status == converter_status::ok) {
+        *result = converted.value;
+    }
+
+    return to_ncc_status(converted.status);
+}
+
+
+ncc_status ncc_convert_batch(ncc_snapshot const* snapshot,
+                             float const* values,
+                             char const* const* from_codes,
+                             size_t count,
+                             char const* to_code,
+                             float* results,
+                             ncc_status* statuses)
+{
+    if (!snapshot || !to_code
+        || (count && (!values || !from_codes || !results))) {
+        return NCC_INVALID_ARGUMENT;
+    }
+
+    auto const& rates        = *snapshot->rates;
+    auto const* const target = rates.find(to_code);
+    auto first_error         = NCC_OK;
+
+    for (auto i = size_t{0}; i < count; i++) {
+        auto const* const input =
+            from_codes[i] ? rates.find(from_codes[i]) : nullptr;
+
+        auto const status = !from_codes[i]      ? NCC_INVALID_ARGUMENT
+                            : !input || !target ? NCC_UNKNOWN_CURRENCY
+                                                : NCC_OK;
+        if (status == NCC_OK) {
+            auto const value_in_PLN = values[i] * input->rate;
+            results[i]              = value_in_PLN / target->rate;
+        }
+
+        if (statuses) {
+            statuses[i] = status;
+        }
+        if (first_error == NCC_OK) {
+            first_error = status;
+        }
+    }
+
+    return first_error;
+}
+
+
+ncc_status ncc_convert_values(ncc_snapshot const* snapshot,
+                              float const* values,
+                              size_t count,
+                              char const* from_code,
+                              char const* to_code,
+                              float* results)
+{
+    if (!snapshot || !from_code || !to_code
+        || (count && (!values || !results))) {
+        return NCC_INVALID_ARGUMENT;
+    }
+
+    auto const* const input  = snapshot->rates->find(from_code);
+    auto const* const target = snapshot->rates->find(to_code);
+    if (!input || !target) {
+        return NCC_UNKNOWN_CURRENCY;
+    }
+
+    for (auto i = size_t{0}; i < count; i++) {
+        auto const value_in_PLN = values[i] * input->rate;
+        results[i]              = value_in_PLN / target->rate;
+    }
+
+    return NCC_OK;
+}
+
+
+ncc_status ncc_rate_iterator_init(ncc_rate_iterator* iterator,
+                                  ncc_snapshot const* snapshot,
+                                  char const* language_code)
+{
+    if (!iterator || !snapshot) {
+        return NCC_INVALID_ARGUMENT;
+    }
+
+    iterator->snapshot    = snapshot;
+    iterator->language_id = -1;
+    iterator->index       = 0;
+
+    if (!language_code) {
+        return NCC_OK;
+    }
+
+    try {
+        // language codes fit into the small string buffer
+        iterator->language_id =
+            snapshot->rates->currency_names()->language_id(language_code);
+    } catch (...) {
+        return NCC_OUT_OF_MEMORY;
+    }
+
+    return iterator->language_id == -1 ? NCC_UNKNOWN_LANGUAGE : NCC_OK;
+}
+
+
+int ncc_rate_iterator_next(ncc_rate_iterator* iterator, ncc_rate* rate)
+{
+    if (!iterator || !iterator->snapshot || !rate) {
+        return 0;
+    }
+
+    auto const& rates = iterator->snapshot->rates->rates();
+    if (iterator->index >= rates.size()) {
+        return 0;
+    }
+
+    auto const& each = rates[iterator->index++];
+
+    rate->code           = each.code.c_str();
+    rate->effective_date = each.effective_date.c_str();
+    rate->rate           = each.rate;
+    rate->table          = each.table;
+    rate->name           = nullptr;
+    rate->name_length    = 0;
+
+    auto const& names = *iterator->snapshot->rates->currency_names();
+    auto name         = std::string_view{};
+    if (names.find(iterator->language_id, each.code, name)) {
+        rate->name        = name.data();
+        rate->name_length = name.size();
+    }
+
+    return 1;
+}
@@ -0,0 +1,1177 @@
+/*
+console NBP currency converter
+
+MIT License
+
+Copyright (c) 2021 Kajetan Welc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+The library part of the converter, see include/currency_converter_core.h.
+*/
+
+#include <bid_ask_routes.h>
+#include <currency_converter_core.h>
+#include <gzip_file.h>
+#include <http_client.h>
+#include <rate_backfill.h>
+#include <rate_providers.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iterator>
+#include <thread>
+
+
+using rolling_rates_map =
+    std::map<std::string, currency_rolling_stats, std::less<>>;
+
+
+static auto base_url_from_env(char const* env, std::string const& default_url)
+    -> std::string
+{
+    if (auto const* const url = std::getenv(env)) {
+        return url;
+    }
+
+    return default_url;
+}
+
+
+static auto path_from_env(char const* env) -> std::string
+{
+    auto const* const path = std::getenv(env);
+    return path ? path : "";
+}
+
+
+static auto capitalize_words(std::string str) -> std::string
+{
+    auto capitalize_next_char = bool{true};
+
+    for (auto& character : str) {
+        if (capitalize_next_char) {
+            character = std::toupper(character);
+
+            capitalize_next_char = false;
+            continue;
+        }
+
+        if (character == ' ') {
+            capitalize_next_char = true;
+        }
+    }
+
+    return str;
+}
+
+
+// Keeps the fetched table as DIR/nbp_DATE.json.gz, which the "cache" provider
+// reads when no other source answers.
+static auto save_rates_cache(std::string const& cache_dir,
+                             rate_table const& table) -> void
+{
+    if (cache_dir.empty() || table.publication_date.empty()) {
+        return;
+    }
+
+    auto ec = std::error_code{};
+    std::filesystem::create_directories(cache_dir, ec);
+
+    write_gzip_file(cache_dir + "/nbp_" + table.publication_date + ".json.gz",
+                    rate_table_to_nbp_json(table));
+}
+
+
+// every column got a rate for the last day, carried forward if the table
+// had none
+static auto push_rolling_rates(rate_history const& history,
+                               rolling_rates_map& rolling) -> void
+{
+    for (auto const& code : history.currency_codes()) {
+        auto const it = rolling.try_emplace(code).first;
+        it->second.push(
+            rate_history::from_fixed_point(history.column(code)->last()));
+    }
+}
+
+
+// The rolling statistics are not saved, they are pushed again from the last
+// days of the history.
+static auto make_rolling_rates(rate_history const& history)
+    -> rolling_rates_map
+{
+    auto rolling = rolling_rates_map{};
+
+    auto const days_count  = history.days_count();
+    auto const window_days = *std::max_element(
+        std::begin(ROLLING_STATS_WINDOW_DAYS),
+        std::end(ROLLING_STATS_WINDOW_DAYS));
+
+    for (auto const& code : history.currency_codes()) {
+        auto& stats = rolling[code];
+        history.for_each_block(
+            code,
+            std::max(0, days_count - window_days),
+            days_count,
+            [&](std::int64_t const* values, int const count, int) {
+                for (auto i = 0; i < count; i++) {
+                    stats.push(rate_history::from_fixed_point(values[i]));
+                }
+            });
+    }
+
+    return rolling;
+}
+
+
+static auto fetch_currency_names_json(std::string const& language_code,
+                                      std::string const& url,
+                                      fetch_record& record)
+    -> task_result<std::vector<std::pair<std::string, std::string>>>
+{
+    using result_type =
+        task_result<std::vector<std::pair<std::string, std::string>>>;
+
+    auto const not_cancelled = std::atomic<bool>{false};
+    auto const response      = http_get(url, not_cancelled);
+
+    if (!response.error.empty() || response.status_code >= 400) {
+        return result_type::failure(language_code
+                                    + " currency names HTTP request error");
+    }
+
+    auto const parse_start = std::chrono::steady_clock::now();
+
+    auto names = std::vector<std::pair<std::string, std::string>>{};
+    try {
+        auto const json = nlohmann::json::parse(response.text);
+        for (auto const& [code, name] : json.items()) {
+            names.emplace_back(code, name.get<std::string>());
+        }
+    } catch (...) {
+        return result_type::failure(language_code
+                                    + " currency names API parse error");
+    }
+
+    record.source   = language_code + " names";
+    record.http     = response.timings;
+    record.parse_ms = milliseconds_since(parse_start);
+
+    return result_type::success(std::move(names));
+}
+
+
+rates_snapshot::rates_snapshot()
+    : currency_rates{{"PLN", 1, 0, ""}}
+    , names{std::make_shared<currency_name_table const>()}
+    , rates_history{std::make_shared<rate_history const>()}
+    , rolling_rates{std::make_shared<rolling_rates_map const>()}
+    , routes{std::make_shared<bid_ask_routes const>()}
+{
+    rate_indices.fill(-1);
+    rate_indices[iso4217_id("PLN")] = 0;
+}
+
+
+auto rates_snapshot::index_rates() -> void
+{
+    std::sort(currency_rates.begin(),
+              currency_rates.end(),
+              [](currency_rate const& a, currency_rate const& b) {
+                  return a.code < b.code;
+              });
+
+    rate_indices.fill(-1);
+    for (auto i = std::size_t{0}; i < currency_rates.size(); i++) {
+        if (auto const id = iso4217_id(currency_rates[i].code); id != -1) {
+            rate_indices[id] = (std::int16_t)i;
+        }
+    }
+}
+
+
+auto rates_snapshot::version() const -> std::uint64_t
+{
+    return snapshot_version;
+}
+
+
+auto rates_snapshot::publication_date() const -> std::string const&
+{
+    return date;
+}
+
+
+auto rates_snapshot::provider_name() const -> std::string const&
+{
+    return provider;
+}
+
+
+auto rates_snapshot::rates() const -> std::vector<currency_rate> const&
+{
+    return currency_rates;
+}
+
+
+auto rates_snapshot::bid_ask_rates() const
+    -> std::vector<currency_bid_ask> const&
+{
+    return currency_bid_asks;
+}
+
+
+auto rates_snapshot::currency_names() const
+    -> std::shared_ptr<currency_name_table const> const&
+{
+    return names;
+}
+
+
+auto rates_snapshot::find(std::string_view code) const -> currency_rate const*
+{
+    if (auto const id = iso4217_id(code); id != -1) {
+        auto const index = rate_indices[id];
+        return index == -1 ? nullptr : &currency_rates[index];
+    }
+
+    // the codes outside of the registry
+    auto const it = std::lower_bound(
+        currency_rates.begin(),
+        currency_rates.end(),
+        code,
+        [](currency_rate const& rate, std::string_view const& c) {
+            return rate.code < c;
+        });
+
+    return it != currency_rates.end() && it->code == code ? &*it : nullptr;
+}
+
+
+auto rates_snapshot::convert(float value,
+                             std::string_view from,
+                             std::string_view to) const -> conversion_result
+{
+    auto const* const input  = find(from);
+    auto const* const target = find(to);
+    if (!input || !target) {
+        return {0, converter_status::unknown_currency};
+    }
+
+    auto const value_in_PLN = value * input->rate;
+    return {value_in_PLN / target->rate, converter_status::ok};
+}
+
+
+auto rates_snapshot::convert_batch(
+    std::vector<conversion_amount> const& amounts,
+    std::string_view to,
+    std::vector<conversion_result>& results) const -> void
+{
+    results.resize(amounts.size());
+
+    auto const* const target = find(to);
+
+    for (auto i = std::size_t{0}; i < amounts.size(); i++) {
+        auto const* const input = find(amounts[i].code);
+        if (!input || !target) {
+            results[i] = {0, converter_status::unknown_currency};
+            continue;
+        }
+
+        auto const value_in_PLN = amounts[i].value * input->rate;
+        results[i] = {value_in_PLN / target->rate, converter_status::ok};
+    }
+}
+
+
+auto rates_snapshot::table_rows(std::string_view base,
+                                std::vector<std::string> const& targets,
+                                std::string const& language,
+                                std::vector<currency_table_entry>& rows) const
+    -> converter_status
+{
+    rows.clear();
+
+    auto const* const base_rate = find(base);
+    if (!base_rate) {
+        return converter_status::unknown_currency;
+    }
+
+    auto const language_id =
+        language.empty() ? -1 : names->language_id(language);
+    if (!language.empty() && language_id == -1) {
+        return converter_status::unknown_language;
+    }
+
+    auto const add_row = [&](currency_rate const& rate) {
+        if (&rate == base_rate) {
+            return;
+        }
+
+        auto row =
+            currency_table_entry{rate.code, "", rate.rate / base_rate->rate};
+
+        auto name = std::string_view{};
+        if (names->find(language_id, rate.code, name)) {
+            row.name = name;
+        }
+
+        rows.push_back(std::move(row));
+    };
+
+    if (targets.empty()) {
+        for (auto const& rate : currency_rates) {
+            add_row(rate);
+        }
+
+        return converter_status::ok;
+    }
+
+    for (auto const& code : targets) {
+        auto const* const rate = find(code);
+        if (!rate) {
+            rows.clear();
+            return converter_status::unknown_currency;
+        }
+
+        add_row(*rate);
+    }
+
+    return converter_status::ok;
+}
+
+
+auto rates_snapshot::history() const -> rate_history const&
+{
+    return *rates_history;
+}
+
+
+auto rates_snapshot::rolling(std::string_view code) const
+    -> currency_rolling_stats const*
+{
+    auto const it = rolling_rates->find(code);
+    return it == rolling_rates->end() ? nullptr : &it->second;
+}
+
+
+auto rates_snapshot::rolling_codes() const -> std::vector<std::string>
+{
+    auto codes = std::vector<std::string>{};
+    for (auto const& [code, stats] : *rolling_rates) {
+        codes.push_back(code);
+    }
+
+    return codes;
+}
+
+
+auto rates_snapshot::best_routes() const -> bid_ask_routes const&
+{
+    return *routes;
+}
+
+
+auto rates_snapshot::on_day(int day) const
+    -> std::shared_ptr<rates_snapshot const>
+{
+    auto const day_index = rates_history->day_index_at_or_before(day);
+    if (day_index == -1) {
+        return nullptr;
+    }
+
+    auto const table_date = days_to_date(rates_history->day(day_index));
+
+    auto result              = std::make_shared<rates_snapshot>();
+    result->snapshot_version = snapshot_version;
+    result->date             = table_date;
+    result->provider         = "history";
+    result->names            = names;
+    result->rates_history    = rates_history;
+    result->rolling_rates    = rolling_rates;
+
+    for (auto const& [code, rate] : rates_history->rates_at(day_index)) {
+        if (code != "PLN") {
+            result->currency_rates.push_back({code, rate, 0, table_date});
+        }
+    }
+    result->index_rates();
+
+    return result;
+}
+
+
+auto converter_sources::from_env() -> converter_sources
+{
+    auto sources = converter_sources{};
+
+    // the base urls can be pointed at a local stand-in server, see
+    // src/nbp_stub_server.cpp
+    sources.nbp_base_url =
+        base_url_from_env("NBP_CONVERTER_NBP_BASE_URL", "api.nbp.pl");
+    sources.ecb_base_url =
+        base_url_from_env("NBP_CONVERTER_ECB_BASE_URL", "www.ecb.europa.eu");
+    sources.names_base_url = base_url_from_env("NBP_CONVERTER_NAMES_BASE_URL",
+                                               "openexchangerates.org");
+    sources.rates_path = path_from_env("NBP_CONVERTER_RATES_PATH");
+    sources.cache_dir  = path_from_env("NBP_CONVERTER_CACHE_DIR");
+
+    return sources;
+}
+
+
+currency_converter_core::currency_converter_core(converter_sources s)
+    : config{std::move(s)}
+    , names_urls{{"EN", config.names_base_url + "/api/currencies.json"}}
+    , current{std::make_shared<rates_snapshot const>()}
+{
+    // table A first, see nbp_json_provider
+    auto const nbp_urls = std::vector<cpr::Url>{
+        config.nbp_base_url + "/api/exchangerates/tables/a?format=json",
+        config.nbp_base_url + "/api/exchangerates/tables/b?format=json",
+        config.nbp_base_url + "/api/exchangerates/tables/c?format=json"};
+    auto const ecb_url =
+        cpr::Url{config.ecb_base_url + "/stats/eurofxref/eurofxref-daily.xml"};
+
+    providers.push_back(std::make_shared<nbp_json_provider>(nbp_urls, 0));
+    providers.push_back(std::make_shared<ecb_xml_provider>(ecb_url, 1));
+
+    if (!config.rates_path.empty()) {
+        providers.push_back(
+            std::make_shared<local_file_provider>(config.rates_path, 2));
+    }
+
+    if (!config.cache_dir.empty()) {
+        auto cache = std::make_shared<local_file_provider>(
+            config.cache_dir, 3, "cache");
+        cache->last_resort = true;
+        providers.push_back(std::move(cache));
+    }
+}
+
+
+currency_converter_core::~currency_converter_core()
+{
+    cancel_pending_tables();
+}
+
+
+auto currency_converter_core::sources() const -> converter_sources const&
+{
+    return config;
+}
+
+
+auto currency_converter_core::provider_names() const
+    -> std::vector<std::string>
+{
+    auto names = std::vector<std::string>{};
+    for (auto const& provider : providers) {
+        names.push_back(provider->name());
+    }
+
+    return names;
+}
+
+
+auto currency_converter_core::snapshot() const
+    -> std::shared_ptr<rates_snapshot const>
+{
+    return std::atomic_load(&current);
+}
+
+
+// the caller holds mtx
+auto currency_converter_core::publish(std::shared_ptr<rates_snapshot> next)
+    -> void
+{
+    next->snapshot_version = current->snapshot_version + 1;
+    std::atomic_store(&current,
+                      std::shared_ptr<rates_snapshot const>{std::move(next)});
+
+    if (shares_rates) {
+        publish_shared_rates();
+    }
+}
+
+
+// the caller holds mtx
+auto currency_converter_core::publish_shared_rates() -> void
+{
+    auto entries = std::vector<shared_rate_entry>{};
+    for (auto const& rate : current->currency_rates) {
+        auto& entry = entries.emplace_back();
+        entry.code  = rate.code;
+        entry.rate  = rate.rate;
+
+        auto const* const stats = current->rolling(rate.code);
+        for (auto i = 0; i < SHARED_RATES_ROLLING_WINDOWS
+                         && i < ROLLING_STATS_WINDOWS_COUNT && stats;
+             i++) {
+            auto const window = stats->stats(i);
+            entry.rolling[i]  = shared_rolling_stats{(std::uint32_t)window.days,
+                                                    (float)window.mean,
+                                                    (float)window.volatility};
+        }
+    }
+
+    shared_rates.publish(
+        current->date,
+        entries,
+        std::vector<int>(std::begin(ROLLING_STATS_WINDOW_DAYS),
+                         std::end(ROLLING_STATS_WINDOW_DAYS)));
+}
+
+
+auto currency_converter_core::save_history(rate_history const& history) const
+    -> void
+{
+    if (history_path.empty()) {
+        return;
+    }
+
+    auto ec = std::error_code{};
+    std::filesystem::create_directories(
+        std::filesystem::path{history_path}.parent_path(), ec);
+    save_rate_history(history_path, history);
+}
+
+
+// the caller holds mtx
+auto currency_converter_core::replace_history(rate_history history) -> void
+{
+    auto next           = std::make_shared<rates_snapshot>(*current);
+    next->rolling_rates = std::make_shared<rolling_rates_map const>(
+        make_rolling_rates(history));
+    next->rates_history =
+        std::make_shared<rate_history const>(std::move(history));
+
+    save_history(*next->rates_history);
+    publish(std::move(next));
+}
+
+
+auto currency_converter_core::refresh(rate_table* fetched_table)
+    -> refresh_result
+{
+    // the tables of the previous refresh must not land after this one
+    cancel_pending_tables();
+
+    auto result  = refresh_result{};
+    auto table   = rate_table{};
+    auto pending = std::shared_ptr<pending_rate_tables>{};
+
+    result.ok = fetch_first_valid_rate_table(providers,
+                                             table,
+                                             result.provider_name,
+                                             result.stale,
+                                             result.errors,
+                                             result.records,
+                                             pending);
+    if (!result.ok) {
+        for (auto const& record : result.records) {
+            timings.push(record);
+        }
+        return result;
+    }
+
+    auto const apply_start = std::chrono::steady_clock::now();
+    load(table, result.provider_name);
+    auto const apply_ms = milliseconds_since(apply_start);
+
+    for (auto& record : result.records) {
+        if (record.source == result.provider_name) {
+            record.apply_ms = apply_ms;
+        }
+        timings.push(record);
+    }
+
+    if (!result.stale) {
+        save_rates_cache(config.cache_dir, table);
+    }
+
+    if (pending) {
+        std::unique_lock<std::mutex> lck{pending_mtx};
+        pending_tables = pending;
+        pending_load   = std::async(
+            std::launch::async, [this, pending, completed = table]() mutable {
+                load_pending_tables(*pending, std::move(completed));
+            });
+    }
+
+    if (fetched_table) {
+        *fetched_table = std::move(table);
+    }
+
+    return result;
+}
+
+
+auto currency_converter_core::load_pending_tables(pending_rate_tables& pending,
+                                                  rate_table table) -> void
+{
+    auto later = pending.result.get();
+    if (!later.ok) {
+        return;
+    }
+
+    // the letters only order the tables, the rates keep their own ones
+    auto tables = std::map<char, rate_table>{};
+    tables.emplace('A', std::move(table));
+    tables.emplace('B', later.table);
+    auto const completed = merge_nbp_tables(std::move(tables));
+
+    auto const apply_start = std::chrono::steady_clock::now();
+    {
+        std::unique_lock<std::mutex> lck{mtx};
+
+        auto next = std::make_shared<rates_snapshot>(*current);
+        merge_table(*next, later.table);
+        record_history(*next, completed);
+        publish(std::move(next));
+    }
+    later.record.apply_ms = milliseconds_since(apply_start);
+    timings.push(later.record);
+
+    save_rates_cache(config.cache_dir, completed);
+}
+
+
+auto currency_converter_core::cancel_pending_tables() -> void
+{
+    std::unique_lock<std::mutex> lck{pending_mtx};
+    if (pending_tables) {
+        pending_tables->cancelled = true;
+    }
+
+    if (pending_load.valid()) {
+        pending_load.wait();
+    }
+    pending_load   = {};
+    pending_tables = nullptr;
+}
+
+
+auto currency_converter_core::wait_pending_tables() -> void
+{
+    std::unique_lock<std::mutex> lck{pending_mtx};
+    if (pending_load.valid()) {
+        pending_load.wait();
+    }
+    pending_load   = {};
+    pending_tables = nullptr;
+}
+
+
+auto currency_converter_core::merge_table(rates_snapshot& next,
+                                          rate_table const& table) -> void
+{
+    // both are sorted by code, and the rates of the table win
+    auto const by_code = [](auto const& a, auto const& b) {
+        return a.code < b.code;
+    };
+
+    auto kept_rates = std::move(next.currency_rates);
+    next.currency_rates.clear();
+    next.currency_rates.reserve(table.rates.size() + kept_rates.size());
+    std::set_union(table.rates.begin(),
+                   table.rates.end(),
+                   std::make_move_iterator(kept_rates.begin()),
+                   std::make_move_iterator(kept_rates.end()),
+                   std::back_inserter(next.currency_rates),
+                   by_code);
+    next.index_rates();
+
+    if (!table.bid_ask_rates.empty()) {
+        auto kept_bid_asks = std::move(next.currency_bid_asks);
+        next.currency_bid_asks.clear();
+        std::set_union(table.bid_ask_rates.begin(),
+                       table.bid_ask_rates.end(),
+                       std::make_move_iterator(kept_bid_asks.begin()),
+                       std::make_move_iterator(kept_bid_asks.end()),
+                       std::back_inserter(next.currency_bid_asks),
+                       by_code);
+        next.routes = std::make_shared<bid_ask_routes const>(
+            bid_ask_routes::from_bid_ask_rates(next.currency_bid_asks));
+    }
+
+    auto builder = currency_name_table_builder{*next.names};
+    builder.set("PL", "PLN", capitalize_words("Polski złoty"));
+    for (auto const& [code, name] : table.names) {
+        builder.set("PL", code, capitalize_words(name));
+    }
+    next.names = builder.build();
+}
+
+
+auto currency_converter_core::load(rate_table const& table,
+                                   std::string const& provider_name) -> void
+{
+    std::unique_lock<std::mutex> lck{mtx};
+
+    auto next      = std::make_shared<rates_snapshot>(*current);
+    next->date     = table.publication_date;
+    next->provider = provider_name;
+
+    merge_table(*next, table);
+    record_history(*next, table);
+
+    publish(std::move(next));
+}
+
+
+auto currency_converter_core::record_history(rates_snapshot& next,
+                                             rate_table const& table) const
+    -> void
+{
+    auto rates = std::vector<currency_rate>{};
+    auto date  = std::string{};
+    for (auto const& rate : table.rates) {
+        if (rate.table == 'A' || rate.table == 'B') {
+            rates.push_back(rate);
+            date = std::max(date, rate.effective_date);
+        }
+    }
+
+    auto const& history = *next.rates_history;
+    auto const day      = date_to_days(date);
+    auto const last_day =
+        history.days_count() ? history.day(history.days_count() - 1) : -1;
+
+    // loading the same table again copies nothing
+    if (day == -1 || day < last_day
+        || (day == last_day && history.last_day_has(rates))) {
+        return;
+    }
+
+    auto recorded = history;
+    auto rolling  = rolling_rates_map{};
+    if (day > last_day) {
+        recorded.append(date, rates);
+
+        rolling = *next.rolling_rates;
+        push_rolling_rates(recorded, rolling);
+    } else {
+        // the last values were pushed already
+        recorded.merge_last_day(rates);
+        rolling = make_rolling_rates(recorded);
+    }
+
+    next.rates_history =
+        std::make_shared<rate_history const>(std::move(recorded));
+    next.rolling_rates =
+        std::make_shared<rolling_rates_map const>(std::move(rolling));
+
+    save_history(*next.rates_history);
+}
+
+
+auto currency_converter_core::set_currency_names(
+    std::string const& language_code,
+    std::vector<std::pair<std::string, std::string>> const& names) -> void
+{
+    std::unique_lock<std::mutex> lck{mtx};
+
+    auto next = std::make_shared<rates_snapshot>(*current);
+
+    auto builder = currency_name_table_builder{*next->names};
+    for (auto const& [code, name] : names) {
+        builder.set(language_code, code, capitalize_words(name));
+    }
+    next->names = builder.build();
+
+    publish(std::move(next));
+}
+
+
+auto currency_converter_core::fetch_timings() const -> fetch_stats const&
+{
+    return timings;
+}
+
+
+auto currency_converter_core::load_history() -> bool
+{
+    if (config.cache_dir.empty()) {
+        return false;
+    }
+
+    auto history = rate_history{};
+    auto const is_loaded =
+        load_rate_history(config.cache_dir + "/history.txt.gz", history);
+
+    std::unique_lock<std::mutex> lck{mtx};
+
+    history_path = config.cache_dir + "/history.txt.gz";
+    if (is_loaded) {
+        // the days applied before, if any, go after the saved ones
+        history.append_history(*current->rates_history);
+        replace_history(std::move(history));
+    }
+
+    return is_loaded;
+}
+
+
+// sums up the chunks of one backfill pass
+static auto add_backfill_results(
+    std::vector<backfill_chunk> const& chunks,
+    std::vector<backfill_chunk_result> const& results,
+    fetch_stats& timings,
+    backfill_result& result) -> void
+{
+    for (auto i = std::size_t{0}; i < chunks.size(); i++) {
+        result.requests_count += results[i].attempts;
+
+        if (!results[i].record.source.empty()) {
+            timings.push(results[i].record);
+        }
+
+        if (!results[i].error.empty()) {
+            result.errors.push_back(days_to_date(chunks[i].from_day) + " - "
+                                    + days_to_date(chunks[i].to_day) + ": "
+                                    + results[i].error);
+        }
+    }
+}
+
+
+auto currency_converter_core::backfill(int const from_day,
+                                       int const to_day,
+                                       int const jobs,
+                                       double const requests_per_second)
+    -> backfill_result
+{
+    auto result = backfill_result{};
+
+    auto const url_prefix =
+        config.nbp_base_url + "/api/exchangerates/tables/a/";
+
+    auto const history     = snapshot()->rates_history;
+    auto const has_history = history->days_count() > 0;
+    auto const first_day   = has_history ? history->day(0) : to_day + 1;
+    auto const last_day    = has_history
+                                 ? history->day(history->days_count() - 1)
+                                 : from_day - 1;
+
+    // The days before the history are downloaded from the newest range back
+    // and each range is put in front of the history as it comes, so the
+    // history never has a gap. The days after it are appended.
+    if (has_history && from_day < first_day) {
+        auto chunks =
+            make_backfill_chunks(from_day, std::min(to_day, first_day - 1));
+        std::reverse(chunks.begin(), chunks.end());
+
+        auto const results = fetch_backfill_chunks(
+            url_prefix,
+            chunks,
+            jobs,
+            requests_per_second,
+            [&](int, std::vector<rate_table>& tables) {
+                auto older = rate_history{};
+                for (auto const& table : tables) {
+                    older.append(table.publication_date, table.rates);
+                }
+                result.added_count += older.days_count();
+
+                std::unique_lock<std::mutex> lck{mtx};
+
+                older.append_history(*current->rates_history);
+                replace_history(std::move(older));
+            });
+
+        add_backfill_results(chunks, results, timings, result);
+    }
+
+    if (to_day > last_day) {
+        auto const chunks =
+            make_backfill_chunks(std::max(from_day, last_day + 1), to_day);
+        auto const results = fetch_backfill_chunks(
+            url_prefix,
+            chunks,
+            jobs,
+            requests_per_second,
+            [&](int, std::vector<rate_table>& tables) {
+                std::unique_lock<std::mutex> lck{mtx};
+
+                auto next     = std::make_shared<rates_snapshot>(*current);
+                auto appended = *next->rates_history;
+                auto rolling  = *next->rolling_rates;
+
+                for (auto const& table : tables) {
+                    if (appended.append(table.publication_date,
+                                        table.rates)) {
+                        push_rolling_rates(appended, rolling);
+                        result.added_count++;
+                    }
+                }
+
+                next->rates_history =
+                    std::make_shared<rate_history const>(std::move(appended));
+                next->rolling_rates =
+                    std::make_shared<rolling_rates_map const>(
+                        std::move(rolling));
+
+                save_history(*next->rates_history);
+                publish(std::move(next));
+            });
+
+        add_backfill_results(chunks, results, timings, result);
+    }
+
+    return result;
+}
+
+
+auto currency_converter_core::is_known_language(
+    std::string const& language_code) -> bool
+{
+    return snapshot()->currency_names()->language_id(language_code) != -1
+           || names_urls.count(language_code);
+}
+
+
+// the caller holds names_mtx
+auto currency_converter_core::install_currency_names(
+    std::string const& language_code,
+    std::vector<std::pair<std::string, std::string>> const& names,
+    fetch_record& record) -> void
+{
+    auto const apply_start = std::chrono::steady_clock::now();
+    set_currency_names(language_code, names);
+    record.apply_ms = milliseconds_since(apply_start);
+
+    timings.push(record);
+}
+
+
+auto currency_converter_core::load_currency_names(
+    std::string const& language_code) -> task_result<bool>
+{
+    auto fetch = std::shared_future<task_result<bool>>{};
+    {
+        std::unique_lock<std::mutex> lck{names_mtx};
+
+        if (snapshot()->currency_names()->language_id(language_code) != -1) {
+            return task_result<bool>::success(true);
+        }
+
+        auto const url = names_urls.find(language_code);
+        if (url == names_urls.end()) {
+            return task_result<bool>::failure("Unknown language: "
+                                              + language_code);
+        }
+
+        auto& in_flight = names_fetches[language_code];
+        if (!in_flight.valid()) {
+            in_flight = std::async(std::launch::async, [=] {
+                            return fetch_and_install_currency_names(
+                                language_code, url->second);
+                        }).share();
+        }
+        fetch = in_flight;
+    }
+
+    return fetch.get();
+}
+
+
+auto currency_converter_core::fetch_and_install_currency_names(
+    std::string const& language_code,
+    std::string const& url) -> task_result<bool>
+{
+    auto record      = fetch_record{};
+    auto const names = fetch_currency_names_json(language_code, url, record);
+
+    std::unique_lock<std::mutex> lck{names_mtx};
+
+    // a failed language is fetched again by the next call asking for it
+    names_fetches.erase(language_code);
+
+    if (!names.ok()) {
+        return task_result<bool>::failure(names.error);
+    }
+
+    install_currency_names(language_code, names.value, record);
+
+    return task_result<bool>::success(true);
+}
+
+
+auto currency_converter_core::fetch_currency_names(
+    std::vector<std::pair<std::string, std::string>> const& languages,
+    int const jobs) -> std::vector<task_result<bool>>
+{
+    std::vector<task_result<bool>> results(languages.size());
+    auto next_index = std::atomic<int>{0};
+
+    auto const fetch_next = [&] {
+        for (auto i = next_index++; i < (int)languages.size();
+             i = next_index++) {
+            auto const& [language_code, url] = languages[i];
+
+            auto record = fetch_record{};
+            auto const names =
+                fetch_currency_names_json(language_code, url, record);
+            if (!names.ok()) {
+                results[i] = task_result<bool>::failure(names.error);
+                continue;
+            }
+
+            {
+                std::unique_lock<std::mutex> lck{names_mtx};
+                install_currency_names(language_code, names.value, record);
+            }
+
+            results[i] = task_result<bool>::success(true);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (auto i = 0; i < std::min(jobs, (int)languages.size()); i++) {
+        threads.push_back(std::thread{fetch_next});
+    }
+    for (auto& each : threads) {
+        each.join();
+    }
+
+    return results;
+}
+
+
+// the date and provider stand for the rates, the version for the rest
+auto currency_converter_core::rendered_table_key(
+    rates_snapshot const& rates,
+    std::string const& base,
+    std::vector<std::string> const& targets,
+    std::string const& language,
+    int const decimal_points) -> std::string
+{
+    auto key = base + "|" + language + "|" + std::to_string(decimal_points)
+               + "|" + rates.date + "|" + rates.provider + "|";
+    for (auto const& code : targets) {
+        key += code + " ";
+    }
+
+    return key;
+}
+
+
+auto currency_converter_core::render_table(
+    rates_snapshot const& rates,
+    std::string const& base,
+    std::vector<std::string> const& targets,
+    std::string const& language,
+    int const decimal_points,
+    std::string& text) -> bool
+{
+    auto key =
+        rendered_table_key(rates, base, targets, language, decimal_points);
+
+    std::unique_lock<std::mutex> lck{tables_mtx};
+
+    if (auto const* const kept = rendered_tables.find(rates.version(), key)) {
+        text = *kept;
+        return true;
+    }
+
+#if defined(__APPLE__) || defined(__unix__) || defined(__unix)
+    auto const* const base_rate = rates.find(base);
+    if (!base_rate) {
+        return false;
+    }
+
+    auto const show_names  = bool{!language.empty()};
+    auto const language_id = rates.names->language_id(language);
+
+    auto const add_row = [&](currency_rate const& rate) {
+        if (&rate == base_rate) {
+            return true;
+        }
+
+        auto& row = table_rows.emplace_back();
+        row.code  = rate.code;
+        row.rate  = float_to_fixed_string(rate.rate / base_rate->rate,
+                                         decimal_points);
+
+        return !show_names
+               || !rates.names->find(
+                   language_id, rate.code, row.name, row.name_width)
+               || row.name_width != -1;
+    };
+
+    table_rows.clear();
+    if (targets.empty()) {
+        for (auto const& rate : rates.currency_rates) {
+            if (!add_row(rate)) {
+                return false;
+            }
+        }
+    } else {
+        for (auto const& code : targets) {
+            auto const* const rate = rates.find(code);
+            if (!rate || !add_row(*rate)) {
+                return false;
+            }
+        }
+    }
+
+    table_renderer.render(table_rows, show_names, text);
+    rendered_tables.insert(rates.version(), std::move(key), text);
+
+    return true;
+#else
+    // libfort draws another style there
+    return false;
+#endif
+}
+
+
+auto currency_converter_core::keep_table(
+    rates_snapshot const& rates,
+    std::string const& base,
+    std::vector<std::string> const& targets,
+    std::string const& language,
+    int const decimal_points,
+    std::string text) -> void
+{
+    auto key =
+        rendered_table_key(rates, base, targets, language, decimal_points);
+
+    std::unique_lock<std::mutex> lck{tables_mtx};
+    rendered_tables.insert(rates.version(), std::move(key), std::move(text));
+}
+
+
+auto currency_converter_core::share_rates() -> void
+{
+    std::unique_lock<std::mutex> lck{mtx};
+
+    shares_rates = true;
+    if (!current->date.empty()) {
+        publish_shared_rates();
+    }
+}
@@ -45,6 +45,7 @@ auto program_args_to_string(int argc, char* argv[]) -> std::string
 auto main(int argc, char* argv[]) -> int
 {
     auto cc = currency_converter{};
+    cc.share_rates();
 
     if (argc == 1) {
         cc.start();
@@ -0,0 +1,549 @@
+/*
+console NBP currency converter
+
+MIT License
+
+Copyright (c) 2021 Kajetan Welc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+Local stand-in for the NBP, ECB and openexchangerates.org APIs (Linux/macOS).
+
+  record DIR URL...      fetch the urls and save their bodies into DIR
+  serve DIR [OPTIONS...] serve the saved bodies over HTTP
+
+A request is answered with the file named after its path, e.g.
+/api/exchangerates/tables/a?format=json is served from
+DIR/api_exchangerates_tables_a. The query string is ignored.
+
+Date range queries of the NBP tables, e.g.
+/api/exchangerates/tables/a/2021-01-01/2021-03-31/, are made up from the saved
+table of the letter: one table per weekday with rates that drift from day to
+day, 400 for ranges over 93 days like the real API and 404 if no weekday falls
+in the range.
+
+Serve options:
+  --port N                 listen on 127.0.0.1:N (default 8080)
+  --profile NAME           fast, slow, flaky or broken
+  --latency-ms N           delay before the response headers
+  --bandwidth-kbps N       throttle the response body
+  --error-rate P           answer a share P of the requests with an error
+  --error-status N         HTTP status of the injected errors (default 503)
+  --truncate               injected errors cut the body in half instead
+  --synthetic-tables N     repeat every NBP table N times in the response
+  --no-gzip                ignore Accept-Encoding and send the bodies raw
+
+Point the converter at it with:
+  NBP_CONVERTER_NBP_BASE_URL=localhost:8080
+  NBP_CONVERTER_ECB_BASE_URL=localhost:8080
+  NBP_CONVERTER_NAMES_BASE_URL=localhost:8080
+*/
+
+#include <cpr/cpr.h>  // https://github.com/whoshuu/cpr
+#include <gzip_file.h>
+#include <nlohmann/json.hpp>  // https://github.com/nlohmann/json
+#include <rate_history.h>
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <netinet/in.h>
+#include <random>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using json = nlohmann::json;
+
+
+struct stub_profile {
+    int port             = 8080;
+    int latency_ms       = 0;
+    int bandwidth_kbps   = 0;
+    double error_rate    = 0;
+    int error_status     = 503;
+    bool truncate        = false;
+    int synthetic_tables = 1;
+    bool gzip            = true;
+};
+
+
+auto path_to_file_name(std::string path) -> std::string
+{
+    auto const scheme_index = path.find("://");
+    if (scheme_index != std::string::npos) {
+        path = path.substr(scheme_index + 3);
+    }
+
+    auto const path_index = path.find('/');
+    if (path.empty() || path[0] != '/') {
+        path = path_index == std::string::npos ? "/" : path.substr(path_index);
+    }
+
+    auto const query_index = path.find('?');
+    if (query_index != std::string::npos) {
+        path = path.substr(0, query_index);
+    }
+
+    while (path.size() > 1 && path.back() == '/') {
+        path.pop_back();
+    }
+
+    auto file_name = path.substr(1);
+    for (auto& character : file_name) {
+        if (character == '/') {
+            character = '_';
+        }
+    }
+
+    return file_name;
+}
+
+
+auto read_file(std::string const& file_path, std::string& str) -> bool
+{
+    std::ifstream file{file_path, std::ios::binary};
+    if (!file) {
+        return false;
+    }
+
+    std::stringstream tmp_ss;
+    tmp_ss << file.rdbuf();
+    str = tmp_ss.str();
+
+    return true;
+}
+
+
+auto record(std::string const& dir, std::vector<std::string> const& urls)
+    -> int
+{
+    auto exit_code = int{0};
+
+    for (auto const& url : urls) {
+        auto const response  = cpr::Get(cpr::Url{url});
+        auto const file_path = dir + "/" + path_to_file_name(url);
+
+        if (response.error || response.status_code >= 400) {
+            std::cerr << url << ": HTTP request error\n";
+            exit_code = 1;
+            continue;
+        }
+
+        std::ofstream file{file_path, std::ios::binary};
+        file << response.text;
+        std::cout << url << " => " << file_path << " ("
+                  << response.text.size() << " bytes)\n";
+    }
+
+    return exit_code;
+}
+
+
+// Repeats the first table of an NBP response with slightly moved rates to get
+// payloads the size of multi-table and history downloads.
+auto make_synthetic_tables(std::string const& body, int const& count)
+    -> std::string
+{
+    auto tables = json{};
+    try {
+        tables = json::parse(body);
+    } catch (...) {
+        return body;
+    }
+
+    if (!tables.is_array() || tables.empty() || count <= 1) {
+        return body;
+    }
+
+    auto const first = tables[0];
+    auto result      = json::array();
+    for (auto i = 0; i < count; i++) {
+        auto table = first;
+        for (auto& rate : table["rates"]) {
+            for (auto const& key : {"mid", "bid", "ask"}) {
+                if (rate.contains(key)) {
+                    rate[key] =
+                        rate[key].get<float>() * (1 + (i % 7) * 0.0001f);
+                }
+            }
+        }
+        table["no"] = std::to_string(i) + "/"
+                      + table.value("table", std::string{"A"}) + "/NBP/STUB";
+        result.push_back(table);
+    }
+
+    return result.dump();
+}
+
+
+// Answers api_exchangerates_tables_X_FROM_TO from api_exchangerates_tables_X.
+// The rates of a day only depend on the day, so the tables of overlapping
+// ranges agree. Returns false if the file name is no date range query.
+auto make_date_range_tables(std::string const& dir,
+                            std::string const& file_name,
+                            int& status,
+                            std::string& body) -> bool
+{
+    auto const prefix = std::string{"api_exchangerates_tables_"};
+    auto const dates_size = std::string{"_YYYY-MM-DD_YYYY-MM-DD"}.size();
+    if (file_name.rfind(prefix, 0) != 0
+        || file_name.size() != prefix.size() + 1 + dates_size) {
+        return false;
+    }
+
+    auto const base_name = file_name.substr(0, prefix.size() + 1);
+    auto const from_day  = date_to_days(file_name.substr(base_name.size() + 1,
+                                                         10));
+    auto const to_day = date_to_days(file_name.substr(base_name.size() + 12));
+
+    auto base_body = std::string{};
+    if (from_day == -1 || to_day == -1
+        || !read_file(dir + "/" + base_name, base_body)) {
+        return false;
+    }
+
+    if (to_day < from_day || to_day - from_day + 1 > 93) {
+        status = 400;
+        body   = "Przekroczony limit 93 dni";
+        return true;
+    }
+
+    auto first = json{};
+    try {
+        first = json::parse(base_body).at(0);
+    } catch (...) {
+        return false;
+    }
+
+    auto tables = json::array();
+    for (auto day = from_day; day <= to_day; day++) {
+        // 1970-01-01 was a Thursday
+        auto const weekday = ((day % 7) + 7 + 3) % 7;
+        if (weekday >= 5) {
+            continue;
+        }
+
+        auto table             = first;
+        table["effectiveDate"] = days_to_date(day);
+        table["no"] = std::to_string(day) + "/"
+                      + table.value("table", std::string{"A"}) + "/NBP/STUB";
+
+        auto currency_index = 0;
+        for (auto& rate : table["rates"]) {
+            auto const drift =
+                1 + 0.05 * std::sin(day / 60.0 + currency_index++);
+            for (auto const& key : {"mid", "bid", "ask"}) {
+                if (rate.contains(key)) {
+                    rate[key] = rate_history::to_fixed_point(
+                                    rate[key].get<double>() * drift)
+                                / RATE_HISTORY_PER_UNIT;
+                }
+            }
+        }
+
+        tables.push_back(table);
+    }
+
+    if (tables.empty()) {
+        status = 404;
+        body   = "404 NotFound - Not Found - Brak danych";
+        return true;
+    }
+
+    status = 200;
+    body   = tables.dump();
+    return true;
+}
+
+
+auto send_all(int const& fd, char const* data, std::size_t size) -> bool
+{
+    while (size) {
+        auto const sent = send(fd, data, size, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            return false;
+        }
+
+        data += sent;
+        size -= sent;
+    }
+
+    return true;
+}
+
+
+auto accepts_gzip(std::string request) -> bool
+{
+    std::transform(
+        request.begin(), request.end(), request.begin(), [](char c) {
+            return (char)std::tolower((unsigned char)c);
+        });
+
+    auto const header_index = request.find("\r\naccept-encoding:");
+    if (header_index == std::string::npos) {
+        return false;
+    }
+
+    auto const line_end = request.find("\r\n", header_index + 2);
+    return request.substr(header_index, line_end - header_index).find("gzip")
+           != std::string::npos;
+}
+
+
+auto serve_connection(int const fd,
+                      std::string const& dir,
+                      stub_profile const& profile,
+                      bool const inject_error) -> void
+{
+    auto request = std::string{};
+    char buffer[4096];
+    while (request.find("\r\n\r\n") == std::string::npos) {
+        auto const received = recv(fd, buffer, sizeof(buffer), 0);
+        if (received <= 0) {
+            close(fd);
+            return;
+        }
+        request.append(buffer, received);
+    }
+
+    auto method = std::string{};
+    auto target = std::string{};
+    std::stringstream{request} >> method >> target;
+
+    if (profile.latency_ms) {
+        std::this_thread::sleep_for(
+            std::chrono::milliseconds{profile.latency_ms});
+    }
+
+    auto status          = int{200};
+    auto body            = std::string{};
+    auto const file_name = path_to_file_name(target);
+    auto const is_file =
+        !file_name.empty() && read_file(dir + "/" + file_name, body);
+    if (!is_file && !make_date_range_tables(dir, file_name, status, body)) {
+        status = 404;
+        body   = "Not Found";
+    } else if (inject_error && !profile.truncate) {
+        status = profile.error_status;
+        body   = "Injected error";
+    } else if (is_file
+               && file_name.rfind("api_exchangerates_tables_", 0) == 0) {
+        body = make_synthetic_tables(body, profile.synthetic_tables);
+    }
+
+    auto content_type = std::string{"application/json; charset=utf-8"};
+    if (file_name.size() > 4
+        && file_name.compare(file_name.size() - 4, 4, ".xml") == 0) {
+        content_type = "text/xml; charset=utf-8";
+    }
+
+    auto content_encoding = std::string{};
+    if (profile.gzip && accepts_gzip(request)) {
+        body             = gzip_compress(body);
+        content_encoding = "Content-Encoding: gzip\r\n";
+    }
+
+    auto const content_length = body.size();
+    if (inject_error && profile.truncate) {
+        body.resize(body.size() / 2);
+    }
+
+    auto const header = "HTTP/1.1 " + std::to_string(status) + " Stub\r\n"
+                        + "Content-Type: " + content_type + "\r\n"
+                        + content_encoding
+                        + "Content-Length: " + std::to_string(content_length)
+                        + "\r\nConnection: close\r\n\r\n";
+
+    if (send_all(fd, header.data(), header.size())) {
+        if (!profile.bandwidth_kbps) {
+            send_all(fd, body.data(), body.size());
+        } else {
+            // 100 ms slices of the allowed bandwidth
+            auto const slice_size =
+                std::max<std::size_t>(1, profile.bandwidth_kbps * 1024 / 80);
+            for (auto offset = std::size_t{0}; offset < body.size();
+                 offset += slice_size) {
+                auto const size = std::min(slice_size, body.size() - offset);
+                if (!send_all(fd, body.data() + offset, size)) {
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds{100});
+            }
+        }
+    }
+
+    close(fd);
+}
+
+
+auto apply_named_profile(std::string const& name, stub_profile& profile)
+    -> bool
+{
+    if (name == "fast") {
+        profile.latency_ms     = 0;
+        profile.bandwidth_kbps = 0;
+        profile.error_rate     = 0;
+    } else if (name == "slow") {
+        profile.latency_ms     = 800;
+        profile.bandwidth_kbps = 256;
+    } else if (name == "flaky") {
+        profile.latency_ms = 50;
+        profile.error_rate = 0.2;
+    } else if (name == "broken") {
+        profile.error_rate = 1;
+        profile.truncate   = true;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+
+auto serve(std::string const& dir, stub_profile const& profile) -> int
+{
+    auto const listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd == -1) {
+        std::cerr << "Cannot create socket\n";
+        return 1;
+    }
+
+    auto const reuse = int{1};
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address{};
+    address.sin_family      = AF_INET;
+    address.sin_port        = htons(profile.port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (bind(listen_fd, (sockaddr*)&address, sizeof(address)) == -1
+        || listen(listen_fd, 64) == -1) {
+        std::cerr << "Cannot listen on port " << profile.port << "\n";
+        close(listen_fd);
+        return 1;
+    }
+
+    std::cout << "Serving " << dir << " on localhost:" << profile.port
+              << std::endl;
+
+    // a fixed seed keeps the injected errors repeatable between runs
+    std::mt19937 random_engine{2021};
+    std::uniform_real_distribution<double> distribution{0, 1};
+
+    while (true) {
+        auto const fd = accept(listen_fd, nullptr, nullptr);
+        if (fd == -1) {
+            continue;
+        }
+
+        auto const inject_error = bool{profile.error_rate > 0
+                                       && distribution(random_engine)
+                                              < profile.error_rate};
+
+        std::thread{serve_connection, fd, dir, profile, inject_error}.detach();
+    }
+}
+
+
+auto print_usage() -> void
+{
+    std::cerr << "Usage:\n"
+              << "  nbp_stub_server record DIR URL...\n"
+              << "  nbp_stub_server serve DIR [--port N] [--profile "
+                 "fast|slow|flaky|broken]\n"
+              << "      [--latency-ms N] [--bandwidth-kbps N] "
+                 "[--error-rate P]\n"
+              << "      [--error-status N] [--truncate] "
+                 "[--synthetic-tables N] [--no-gzip]\n";
+}
+
+
+auto main(int argc, char* argv[]) -> int
+{
+    auto const args = std::vector<std::string>(argv + 1, argv + argc);
+
+    if (args.size() < 2) {
+        print_usage();
+        return 1;
+    }
+
+    auto const& mode = args[0];
+    auto const& dir  = args[1];
+
+    if (mode == "record" && args.size() > 2) {
+        return record(dir,
+                      std::vector<std::string>(args.begin() + 2, args.end()));
+    }
+
+    if (mode != "serve") {
+        print_usage();
+        return 1;
+    }
+
+    auto profile = stub_profile{};
+    try {
+        for (auto i = std::size_t{2}; i < args.size(); i++) {
+            auto const& option   = args[i];
+            auto const has_value = bool{i + 1 < args.size()};
+
+            if (option == "--truncate") {
+                profile.truncate = true;
+            } else if (option == "--no-gzip") {
+                profile.gzip = false;
+            } else if (!has_value) {
+                print_usage();
+                return 1;
+            } else if (option == "--port") {
+                profile.port = std::stoi(args[++i]);
+            } else if (option == "--profile") {
+                if (!apply_named_profile(args[++i], profile)) {
+                    print_usage();
+                    return 1;
+                }
+            } else if (option == "--latency-ms") {
+                profile.latency_ms = std::stoi(args[++i]);
+            } else if (option == "--bandwidth-kbps") {
+                profile.bandwidth_kbps = std::stoi(args[++i]);
+            } else if (option == "--error-rate") {
+                profile.error_rate = std::stod(args[++i]);
+            } else if (option == "--error-status") {
+                profile.error_status = std::stoi(args[++i]);
+            } else if (option == "--synthetic-tables") {
+                profile.synthetic_tables = std::stoi(args[++i]);
+            } else {
+                print_usage();
+                return 1;
+            }
+        }
+    } catch (...) {
+        print_usage();
+        return 1;
+    }
+
+    return serve(dir, profile);
+}